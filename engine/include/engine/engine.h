@@ -2,7 +2,27 @@
 
 #include "vk_types.h"
 #include "engine/vk_descriptors.h"
+#include "engine/frame_stats.h"
+#include "engine/vk_deletion_queue.h"
 #include "../src/vk_pipelines.h"
+#include "../src/vk_profiler.h"
+#include "../src/vk_timeline.h"
+#include "../src/vk_upload.h"
+#include "../src/vk_staging_ring.h"
+#include "../src/vk_pipeline_compiler.h"
+#include "../src/vk_object_cache.h"
+#include "../src/vk_bindless.h"
+#include "../src/vk_render_graph.h"
+#include "../src/dynamic_resolution.h"
+#include "../src/job_system.h"
+#include "../src/vk_parallel_recorder.h"
+#include "../src/render_packet.h"
+#include "../src/scene.h"
+#include "../src/gpu_scene.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
 //#include <memory>
 //#include <tracy/Tracy.hpp>
 
@@ -13,33 +33,6 @@ class VulkanEngine{
 
 // #define _NO_DEBUG_HEAP 1
 
-// TODO: because we are storing whole std::functions for every object we are deleting,
-// which is not going to be optimal. For the amount of objects we will use in this tutorial,
-//  its going to be fine. but if you need to delete thousands of objects and want them deleted faster,
-// a better implementation would be to store arrays of vulkan handles of various types such as VkImage,
-//   VkBuffer, and so on. And then delete those from a loop.
-struct DeletionQueue
-{
-    std::deque<std::function<void()>> deletors;
-
-    void push_function(std::function<void()> &&function)
-    {
-        deletors.push_back(function);
-    }
-
-    void flush()
-    {
-        ZoneScoped;
-        // reverse iterate the deletion queue to execute all the functions
-        for (auto it = deletors.rbegin(); it != deletors.rend(); it++)
-        {
-            (*it)(); // call functors
-        }
-
-        deletors.clear();
-    }
-};
-
 struct FrameData
 {
 
@@ -47,11 +40,133 @@ struct FrameData
     VkCommandBuffer _mainCommandBuffer;
 
     VkSemaphore _swapchainSemaphore, _renderSemaphore;
-    VkFence _renderFence;
-    DeletionQueue _deletionQueue;
+    // timeline value signaled by this frame's submission
+    uint64_t _timelineValue{0};
+
+    // async compute: background passes recorded for the compute queue family
+    VkCommandPool _computeCommandPool{VK_NULL_HANDLE};
+    VkCommandBuffer _computeCommandBuffer{VK_NULL_HANDLE};
+
+    // descriptor sets that live for one frame, reset wholesale once the slot's frame retired
+    DescriptorAllocatorGrowable _frameDescriptors;
+
+    // when draw() started on the cpu, for the cpu -> gpu latency in FrameStats
+    std::chrono::steady_clock::time_point _cpuBeginTime{};
+    // dynamic resolution scale the frame was rendered at
+    float _renderScale{1.0f};
 };
 
-constexpr unsigned int FRAME_OVERLAP = 3;
+// upper bound of RendererConfig::framesInFlight. per-slot objects that are cheap (timestamp pools,
+// imgui's vertex buffer ring) are sized for it, so changing the setting does not touch them
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// how frames are handed to the presentation engine, can be switched at runtime
+enum class PresentPolicy : uint8_t
+{
+    VSync,      // fifo: paced by the display, never tears
+    LowLatency, // mailbox: the newest frame replaces a queued one, no tearing. falls back to immediate, then fifo
+    Uncapped,   // immediate: may tear, for benchmarks. falls back to mailbox, then fifo
+};
+
+// renderer settings that can change at runtime. the simulation side owns them, every render packet
+// carries a copy and the render thread applies the differences before drawing it
+struct RendererSettings
+{
+    PresentPolicy presentPolicy{PresentPolicy::VSync};
+    uint32_t framesInFlight{3};
+    float frameRateLimit{0.0f};
+    DynamicResolution::Settings dynamicResolution{};
+};
+
+// camera the geometry pass renders with. the projection is an infinite reverse-z perspective,
+// its aspect ratio follows the draw extent
+struct Camera
+{
+    glm::mat4 view{1.0f};
+    // radians
+    float fovY{1.2217305f};
+    float nearPlane{0.1f};
+};
+
+// everything the render thread needs to draw a frame, built by the simulation thread and not
+// touched by it again until the render thread hands the packet back
+struct RenderPacket
+{
+    uint64_t frameNumber{0};
+    // when input for the packet was sampled, latency is measured from here
+    std::chrono::steady_clock::time_point inputTime{};
+    // the window changed size since the previous packet
+    bool windowResized{false};
+    RendererSettings settings{};
+    UiDrawSnapshot ui;
+    Camera camera{};
+    // GpuScene objects added, moved or removed since the previous packet, later entries win
+    std::vector<ObjectUpdate> objectUpdates;
+};
+
+// render thread state shown by the settings window, published after every frame
+struct RendererStatus
+{
+    VkPresentModeKHR presentMode{VK_PRESENT_MODE_FIFO_KHR};
+    VkExtent2D drawExtent{0, 0};
+    float renderScale{1.0f};
+    double gpuMs{0.0};
+    double predictedMs{0.0};
+    uint32_t resolutionChanges{0};
+    // frame graph of the last frame
+    uint32_t culledPasses{0};
+    uint32_t barrierBatches{0};
+    uint32_t parallelPasses{0};
+};
+
+// settings handed to VulkanRenderer::init()
+struct RendererConfig
+{
+    // render into offscreen targets without SDL window, surface and swapchain
+    // (render nodes, perf CI on lavapipe). frames complete on the timeline semaphore only.
+    bool headless{false};
+    VkExtent2D windowExtent{1700, 900};
+    // number of frames run() renders before it returns, 0 = until the window is closed
+    uint32_t maxFrames{0};
+    // directory containing the compiled *.spv shaders
+    std::string shaderDirectory{"O:/projects/dev/UFMO/testapp/shaders"};
+    // fixed frame delta time in seconds handed to imgui, 0 = measured. keeps benchmark runs deterministic
+    float fixedDeltaTime{0.0f};
+    // record cpu frame, zone and gpu frame times into FrameStats, ignoring the first statsWarmupFrames
+    bool collectFrameStats{false};
+    uint32_t statsWarmupFrames{0};
+    // run compute passes on a separate compute queue family when the device has one,
+    // otherwise they stay on the graphics queue
+    bool asyncCompute{true};
+    // bytes of persistently mapped staging memory per frame in flight, grows when a frame needs more
+    VkDeviceSize stagingRingSize{1024 * 1024};
+    // pipeline cache blob loaded at startup and written back on shutdown, empty = do not persist
+    std::string pipelineCachePath{"pipeline_cache.bin"};
+    // pipelines compiled at once on the job system, 0 = job workers - 1
+    uint32_t pipelineCompileThreads{0};
+    // frames the cpu may record ahead of the gpu, 1 .. MAX_FRAMES_IN_FLIGHT.
+    // fewer = lower latency, more = the cpu and gpu stall less on each other
+    uint32_t framesInFlight{3};
+    // draw image size, the window can be resized up to it without reallocating.
+    // 0 = size of the display the window opens on (at least the window size)
+    VkExtent2D maxDrawExtent{0, 0};
+    // ignored headless
+    PresentPolicy presentPolicy{PresentPolicy::VSync};
+    // frames per second run() is held to, 0 = no limit. mostly for the low latency / uncapped policies
+    float frameRateLimit{0.0f};
+    // job system worker threads next to the main thread, 0 = hardware threads - 1
+    uint32_t jobThreads{0};
+    // render scale driven by gpu frame time, disabled = always maxScale
+    DynamicResolution::Settings dynamicResolution{};
+    // record and submit on a render thread while the main thread builds the next packets.
+    // false = build and draw every packet on the main thread
+    bool renderThread{true};
+    // packets the simulation may run ahead of the render thread. 1 = double buffered, one packet is
+    // drawn while the next one is built
+    uint32_t packetQueueDepth{1};
+    // MeshInstances the gpu driven geometry pass can hold, addMeshInstance() fails past it
+    uint32_t maxSceneObjects{65536};
+};
 
 struct AllocatorCallback {
     // TODO: allocator callback implementation    
@@ -65,23 +180,40 @@ struct BasicVulkanData {
     VkDebugUtilsMessengerEXT debug_messenger; // Vulkan debug output handle
     VkPhysicalDevice chosenGPU;               // GPU chosen as the default device
     VkDevice device;                          // Vulkan device for commands
-    VkSurfaceKHR surface;                     // Vulkan window surface
+    VkSurfaceKHR surface{VK_NULL_HANDLE};     // Vulkan window surface
     struct SDL_Window* window{nullptr};
+    bool headless{false};                     // no window / surface / swapchain
     VkExtent2D windowExtent{1700, 900};
     VmaAllocator allocator;
     //draw resources
 	AllocatedImage drawImage;
+	// async compute: second draw image, compute writes one while graphics still reads the other
+	AllocatedImage drawImageAlt;
+	// reverse-z depth of the geometry pass, maxDrawExtent like the draw images
+	AllocatedImage depthImage;
+	bool asyncCompute{false};
+	// frame slots in use, headless creates one offscreen target per slot
+	uint32_t framesInFlight{3};
+	// size the draw images are allocated with, drawExtent is the part of it rendered this frame
+	VkExtent2D maxDrawExtent;
 	VkExtent2D drawExtent;
+    PresentPolicy presentPolicy{PresentPolicy::VSync};
     DeletionQueue mainDeletionQueue;
 };
 
 
 struct SwapchainData{
-    VkSwapchainKHR swapchain;
+    VkSwapchainKHR swapchain{VK_NULL_HANDLE};
     VkFormat swapchainImageFormat;
     std::vector<VkImage> swapchainImages;
     std::vector<VkImageView> swapchainImageViews;
+    // tracked per image, reset whenever the images are (re)created
+    std::vector<ImageState> swapchainImageStates;
     VkExtent2D swapchainExtent;
+    // what the surface gave us for the requested PresentPolicy
+    VkPresentModeKHR presentMode{VK_PRESENT_MODE_FIFO_KHR};
+    // headless: backing memory of the offscreen targets standing in for the swapchain images
+    std::vector<VmaAllocation> offscreenAllocations;
 };
 
 class Swapchain
@@ -91,12 +223,19 @@ public:
     ~Swapchain();
 
     void initSwapchain();    
-    void createSwapchain(uint32_t width, uint32_t height);
+    bool createSwapchain(uint32_t width, uint32_t height);
+    // creates a new swapchain from the current one, the old swapchain and its views are pushed to
+    // retireQueue with retireValue. returns false when creation failed (e.g. zero extent)
+    bool recreateSwapchain(uint32_t width, uint32_t height, DeletionQueue &retireQueue, uint64_t retireValue);
+    // creates the targets missing for vulkanData.framesInFlight, existing ones are kept
+    void createOffscreenTargets(uint32_t width, uint32_t height);
     SwapchainData& getDataRef() {return m_data;};
 
     
 	
 private:
+    void createDrawImage(AllocatedImage& image);
+    void createDepthImage(AllocatedImage& image);
     
     //TODO: better modularisationb and naming
     BasicVulkanData& m_vulkanData;
@@ -119,55 +258,240 @@ private:
     bool _isInitialized{false};
     int _frameNumber{0};
     bool stop_rendering{false};    
+    RendererConfig _config;
 
     // instance + device
     BasicVulkanData vulkanData;
     
     // Swapchain
     std::unique_ptr<Swapchain> p_swapchain;
+    // window resized or present reported suboptimal, recreated before the next acquire
+    bool _swapchainDirty{false};
+    // recreates the swapchain at the window's drawable size, false while the window has no area
+    bool resize_swapchain();
+
+    // simulation thread (the one calling run()): events, imgui and the packets it hands over
+    RendererSettings _settings;
+    uint64_t _simFrameNumber{0};
+    // world matrices are brought up to date before every packet
+    Scene _scene;
+    PacketQueue<RenderPacket> _packets;
+    Camera _camera;
+    // GpuScene object slots of the MeshInstances, freed with their entity
+    uint32_t _nextObject{0};
+    std::vector<uint32_t> _freeObjects;
+    // addMeshInstance() reports a full scene once, until an object is freed again
+    bool _objectsFullReported{false};
+    // removals waiting for the next packet
+    std::vector<ObjectUpdate> _objectUpdates;
+    void on_mesh_instance_destroyed(entt::registry &registry, entt::entity entity);
+    // fills packet with this frame's input, ui, settings, camera and object changes
+    void simulate_frame(RenderPacket &packet);
+
+    // render thread: draws the packets in order
+    std::thread _renderThread;
+    void render_loop();
+    void render_packet(RenderPacket &packet);
+    // the packet draw() is working on
+    RenderPacket *_packet{nullptr};
+    // settings of the last packet drawn
+    RendererSettings _renderSettings;
+    void apply_settings(const RendererSettings &settings);
+    void apply_present_policy(PresentPolicy policy);
+
+    // written by the render thread, read by the settings window
+    std::mutex _statusMutex;
+    RendererStatus _status;
+    void publish_status();
+
+    // frame limiter, deadline of the next frame
+    float _frameRateLimit{0.0f};
+    std::chrono::steady_clock::time_point _nextFrameTime{};
+    void limit_frame_rate();
+    // present policy / frame limit window, simulation thread
+    void draw_renderer_settings();
+
+    // picks drawExtent each frame from the gpu frame times
+    DynamicResolution _dynamicResolution;
     
     
 
-    FrameData _frames[FRAME_OVERLAP];
+    // one per frame in flight, rebuilt when the count changes
+    std::vector<FrameData> _frames;
+
+    uint32_t get_frame_slot() const { return _frameNumber % vulkanData.framesInFlight; }
+    FrameData &get_current_frame() { return _frames[get_frame_slot()]; };
+    // command pools, semaphores and descriptor allocators of every slot
+    void init_frames();
+    void destroy_frames();
+    // frames in flight requested by a packet's settings, applied at the start of the next draw()
+    uint32_t _pendingFramesInFlight{0};
+    void apply_frames_in_flight();
+
+    // work stealing scheduler shared by the engine's subsystems, the main thread is worker 0
+    JobSystem _jobs;
+
+    // per worker, per frame slot command pools for secondaries recorded in parallel
+    ParallelRecorder _recorder;
+    void init_recorder();
 
-    FrameData &get_current_frame() { return _frames[_frameNumber % FRAME_OVERLAP]; };
+    // one timeline for every submission, see GpuTimeline
+    GpuTimeline _timeline;
+
+    // objects released while frames are in flight, tagged with the timeline value of their last use
+    DeletionQueue _frameDeletionQueue;
 
     VkQueue _graphicsQueue;
     uint32_t _graphicsQueueFamily;
+
+    // async compute, equal to the graphics queue / family when the device has no separate compute family
+    VkQueue _computeQueue;
+    uint32_t _computeQueueFamily;
+    // compute submissions signal their own timeline, a timeline can only be signaled in order from one queue
+    GpuTimeline _computeTimeline;
+    GpuProfiler _computeProfiler;
+    uint32_t _computeTimestampValidBits{0};
+    // graphics timeline value of the last frame that read drawImage / drawImageAlt
+    uint64_t _drawImageLastUse{0};
+    uint64_t _drawImageAltLastUse{0};
+    // records and submits the background pass on the compute queue, returns the compute timeline value to wait on
+    uint64_t submit_async_compute();
+    RenderGraph _computeGraph;
+
+    // rebuilt every frame, derives the barriers between background, blit and imgui
+    RenderGraph _frameGraph;
+    void record_frame_graph(VkCommandBuffer cmd, uint32_t swapchainImageIndex);
+    void add_background_pass(RenderGraph &graph, RenderGraph::Resource drawImage);
+    // object copies, culling and the indirect geometry draw into drawImage
+    void add_geometry_passes(RenderGraph &graph, RenderGraph::Resource drawImage);
+    // decided once per frame: pipelines ready and objects to draw. with async compute the draw image
+    // is handed over for the geometry pass instead of the blit
+    bool _drawGeometry{false};
+    // camera of the packet at the draw extent's aspect ratio
+    glm::mat4 _viewProjection{1.0f};
+
+    // meshes and objects of the gpu driven geometry pass, render thread except add_mesh()
+    GpuScene _gpuScene;
+    void init_gpu_scene(uint32_t maxObjects);
+
+    // uploads go to a transfer-only family when there is one, otherwise to the graphics queue
+    VkQueue _transferQueue;
+    uint32_t _transferQueueFamily;
+    UploadContext _uploads;
+    // per-frame uniforms and small uploads, rewound when the slot's frame retired
+    StagingRing _stagingRing;
+    VkDeviceSize _stagingAlignment{16};
+    void init_uploads();
+
+    // shared by all pipeline creation
+    PipelineCache _pipelineCache;
+    // pipelines compile on worker threads, init and the frame loop do not wait for them
+    PipelineCompiler _pipelineCompiler;
+
+    // shared set layouts, pipeline layouts and samplers
+    VulkanObjectCache _objectCache;
+
     void init_descriptors();
 
+    // every resource shaders index by integer, bound once per command buffer
+    BindlessHeap _bindless;
+    // storage image slots of drawImage / drawImageAlt, swapped together with the images
+    uint32_t _drawImageIndex{BindlessHeap::INVALID_INDEX};
+    uint32_t _drawImageAltIndex{BindlessHeap::INVALID_INDEX};
+    void init_bindless();
+
+    // benchmark timings
+    FrameStats _frameStats;
+    // gpu timestamps per frame slot, also feeds tracy gpu zones
+    GpuProfiler _gpuProfiler;
+    float _timestampPeriod{1.0f}; // nanoseconds per timestamp tick
+    uint32_t _timestampValidBits{0};
+    bool _calibratedTimestamps{false};
+    void init_profiler();
+    void collect_frame_timestamps(uint32_t frameSlot);
+
 public:
     //immidiate
     // immediate submit structures
-    VkFence _immFence;
     VkCommandBuffer _immCommandBuffer;
     VkCommandPool _immCommandPool;
 
 	
+	// blocks until the gpu finished, use getUploadContext() for uploads
 	void immediate_submit(std::function<void(VkCommandBuffer cmd)>&& function);
     void init_imgui();
 
-    DescriptorAllocator globalDescriptorAllocator;
+    DescriptorAllocatorGrowable globalDescriptorAllocator;
 
-	VkDescriptorSet _drawImageDescriptors;
-	VkDescriptorSetLayout _drawImageDescriptorLayout;
-    	VkPipeline _gradientPipeline;
-	VkPipelineLayout _gradientPipelineLayout;
+    	PipelineHandle _gradientPipeline;
+    PipelineHandle _cullPipeline;
+    PipelineHandle _meshPipeline;
 
     VulkanRenderer &get();
-    uint8_t init();
+    uint8_t init(const RendererConfig& config = {});
     uint8_t initVulkan();
     void run();
     void tearDown();
+    // recreates the swapchain at the given size, the old one retires with the frames still using it
     void createSwapchain(uint32_t width, uint32_t height);
     void initSwapchain();
     void destroySwapchain();
     void initCommands();
 
     void initSyncStructures();
+    // records and submits the packet render_packet() is drawing
     void draw();
     void draw_background(VkCommandBuffer cmd);
+    void draw_cull(VkCommandBuffer cmd);
+    void draw_geometry(VkCommandBuffer cmd);
     void draw_imgui(VkCommandBuffer cmd, VkImageView targetImageView);
+    bool isHeadless() const { return vulkanData.headless; }
+    // the settings below belong to the thread calling run() and reach the renderer with the next packet.
+    // the swapchain is recreated before the packet is drawn when the policy changed
+    void setPresentPolicy(PresentPolicy policy) { _settings.presentPolicy = policy; }
+    PresentPolicy getPresentPolicy() const { return _settings.presentPolicy; }
+    // frames per second, 0 = no limit
+    void setFrameRateLimit(float framesPerSecond) { _settings.frameRateLimit = std::max(framesPerSecond, 0.0f); }
+    float getFrameRateLimit() const { return _settings.frameRateLimit; }
+    void setDynamicResolution(const DynamicResolution::Settings &settings) { _settings.dynamicResolution = settings; }
+    // render thread state, only safe to read outside of run()
+    DynamicResolution &getDynamicResolution() { return _dynamicResolution; }
+    JobSystem &getJobs() { return _jobs; }
+    // owned by the thread calling run(), updated with the job system before each packet is built
+    Scene &getScene() { return _scene; }
+    // thread safe, the mesh can be instanced right away. GpuScene::INVALID_MESH when the scene buffers are full
+    uint32_t addMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices) { return _gpuScene.add_mesh(vertices, indices); }
+    // draws a scene entity with the mesh at its world transform until the entity is destroyed
+    bool addMeshInstance(entt::entity entity, uint32_t mesh);
+    void setCamera(const Camera &camera) { _camera = camera; }
+    const Camera &getCamera() const { return _camera; }
+    // secondaries for the graphics queue, valid while recording the current frame
+    ParallelRecorder &getParallelRecorder() { return _recorder; }
+    // 1 .. MAX_FRAMES_IN_FLIGHT. drains the gpu and rebuilds the frame slots before the packet is drawn
+    void setFramesInFlight(uint32_t count) { _settings.framesInFlight = std::clamp(count, 1u, MAX_FRAMES_IN_FLIGHT); }
+    uint32_t getFramesInFlight() const { return _settings.framesInFlight; }
+    // defers destruction until the submission that uses the object has finished on the gpu.
+    // push with getRetireValue() while recording a frame, or with a known timeline value
+    DeletionQueue &getFrameDeletionQueue() { return _frameDeletionQueue; }
+    uint64_t getRetireValue() const { return DeletionQueue::RETIRE_PENDING; }
+    GpuTimeline &getTimeline() { return _timeline; }
+    FrameStats &getFrameStats() { return _frameStats; }
+    GpuProfiler &getGpuProfiler() { return _gpuProfiler; }
+    PipelineCompiler &getPipelineCompiler() { return _pipelineCompiler; }
+    // sets allocated here are valid until this frame slot comes around again
+    DescriptorAllocatorGrowable &getFrameDescriptors() { return get_current_frame()._frameDescriptors; }
+    bool hasAsyncCompute() const { return vulkanData.asyncCompute; }
+    // batched, non-blocking uploads. a frame recorded after the upload's flush() may already use the data
+    UploadContext &getUploadContext() { return _uploads; }
+    // valid while recording the current frame
+    StagingRing &getStagingRing() { return _stagingRing; }
+    // register resources here and build pipelines with its pipeline_layout(), the renderer binds it
+    BindlessHeap &getBindlessHeap() { return _bindless; }
+    // deduplicated layouts and samplers, owned by the renderer until tearDown()
+    VulkanObjectCache &getObjectCache() { return _objectCache; }
+    AllocatedBuffer create_buffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+    void destroy_buffer(const AllocatedBuffer &buffer);
     void init_pipelines();
 	void init_background_pipelines();
+	void init_geometry_pipelines();
 };
\ No newline at end of file
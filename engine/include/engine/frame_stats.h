@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tracy/Tracy.hpp>
+
+// Collects CPU frame times, named CPU zone times and GPU frame times so a
+// benchmark run can be summarized without attaching the Tracy GUI.
+class FrameStats
+{
+public:
+    struct Summary
+    {
+        size_t count{0};
+        double mean{0.0};
+        double p50{0.0};
+        double p95{0.0};
+        double p99{0.0};
+        double max{0.0};
+    };
+
+    void enable(uint32_t warmupFrames);
+    bool isRecording() const { return m_enabled && m_frameCount >= m_warmupFrames; }
+
+    void beginFrame();
+    void endFrame();
+
+    void addZoneSample(const char *name, double ms);
+    void addGpuSample(double ms);
+    // generic named series (e.g. per pass gpu times)
+    void addSample(const std::string &series, double ms);
+
+    void reset();
+
+    static Summary summarize(std::vector<double> samples);
+
+    // writes p50/p95/p99/max of every series as json, returns false if the file could not be written
+    bool writeJson(const std::string &path, const std::string &label) const;
+
+private:
+    using Series = std::pair<std::string, std::vector<double>>;
+    static std::vector<double> &findSeries(std::vector<Series> &series, const char *name);
+
+    bool m_enabled{false};
+    uint32_t m_warmupFrames{0};
+    uint32_t m_frameCount{0};
+    std::chrono::steady_clock::time_point m_frameStart;
+
+    std::vector<double> m_cpuFrameMs;
+    std::vector<double> m_gpuFrameMs;
+    // few zones per frame, a vector keeps the draw() order for the output
+    std::vector<Series> m_zoneMs;
+    std::vector<Series> m_extraMs;
+};
+
+// times a scope into FrameStats, next to the regular tracy zone
+class ScopedStatsZone
+{
+public:
+    ScopedStatsZone(FrameStats &stats, const char *name)
+        : m_stats(stats), m_name(name), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedStatsZone()
+    {
+        if (m_stats.isRecording())
+        {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+            m_stats.addZoneSample(m_name, elapsed.count());
+        }
+    }
+
+private:
+    FrameStats &m_stats;
+    const char *m_name;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#define STATS_CONCAT_INDIRECT(x, y) x##y
+#define STATS_CONCAT(x, y) STATS_CONCAT_INDIRECT(x, y)
+
+#define StatsZoneScopedN(stats, name) \
+    ZoneScopedN(name);                \
+    ScopedStatsZone STATS_CONCAT(__stats_zone, __LINE__)(stats, name)
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+// Deferred destruction of vulkan objects.
+// Handles are stored in one array per object type and destroyed in tight loops,
+// std::function entries are only a fallback for objects that need custom teardown.
+// Every entry carries the timeline value after which the gpu no longer uses it;
+// flush(completedValue) destroys everything that retired.
+class DeletionQueue
+{
+public:
+    // the value is not known yet, assign_pending() tags it once the owning submission got its value
+    static constexpr uint64_t RETIRE_PENDING = ~0ull - 1;
+
+    void init(VkDevice device, VmaAllocator allocator);
+
+    void push_image(VkImage image, VmaAllocation allocation, uint64_t retireValue = 0);
+    void push_buffer(VkBuffer buffer, VmaAllocation allocation, uint64_t retireValue = 0);
+    void push_image_view(VkImageView view, uint64_t retireValue = 0);
+    void push_sampler(VkSampler sampler, uint64_t retireValue = 0);
+    void push_pipeline(VkPipeline pipeline, uint64_t retireValue = 0);
+    void push_pipeline_layout(VkPipelineLayout layout, uint64_t retireValue = 0);
+    void push_descriptor_set_layout(VkDescriptorSetLayout layout, uint64_t retireValue = 0);
+    void push_descriptor_pool(VkDescriptorPool pool, uint64_t retireValue = 0);
+    void push_command_pool(VkCommandPool pool, uint64_t retireValue = 0);
+    void push_fence(VkFence fence, uint64_t retireValue = 0);
+    void push_semaphore(VkSemaphore semaphore, uint64_t retireValue = 0);
+
+    // fallback for everything that is not a plain handle
+    void push_function(std::function<void()> &&function, uint64_t retireValue = 0);
+
+    // tags every RETIRE_PENDING entry with the timeline value of the submission that used it last
+    void assign_pending(uint64_t retireValue);
+
+    // destroys every entry with retireValue <= completedValue
+    void flush(uint64_t completedValue);
+    // destroys everything
+    void flush();
+
+    size_t size() const;
+
+private:
+    template <typename T>
+    struct Entry
+    {
+        T handle;
+        uint64_t retireValue;
+    };
+
+    struct ImageAllocation
+    {
+        VkImage image;
+        VmaAllocation allocation;
+    };
+
+    struct BufferAllocation
+    {
+        VkBuffer buffer;
+        VmaAllocation allocation;
+    };
+
+    // pending entries can sit anywhere once pushes with known values come in between,
+    // the count lets assign() stop as soon as it tagged all of them
+    template <typename T>
+    struct List
+    {
+        std::vector<Entry<T>> entries;
+        size_t pending{0};
+    };
+
+    template <typename T>
+    static void push(List<T> &list, T handle, uint64_t retireValue);
+    // destroys the retired entries of a list, keeping the others in push order
+    template <typename T, typename Destroy>
+    static void retire(List<T> &list, uint64_t completedValue, Destroy &&destroy);
+    template <typename T>
+    static void assign(List<T> &list, uint64_t retireValue);
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    VmaAllocator m_allocator{VK_NULL_HANDLE};
+
+    List<VkPipeline> m_pipelines;
+    List<VkPipelineLayout> m_pipelineLayouts;
+    List<VkDescriptorPool> m_descriptorPools;
+    List<VkDescriptorSetLayout> m_descriptorSetLayouts;
+    List<VkSampler> m_samplers;
+    List<VkImageView> m_imageViews;
+    List<ImageAllocation> m_images;
+    List<BufferAllocation> m_buffers;
+    List<VkCommandPool> m_commandPools;
+    List<VkFence> m_fences;
+    List<VkSemaphore> m_semaphores;
+    List<std::function<void()>> m_functions;
+};
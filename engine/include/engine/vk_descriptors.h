@@ -4,13 +4,18 @@
 
 //TODO: Move to src
 
+class VulkanObjectCache;
+
 struct DescriptorLayoutBuilder {
 
     std::vector<VkDescriptorSetLayoutBinding> bindings;
 
     void add_binding(uint32_t binding, VkDescriptorType type);
     void clear();
+    // the caller owns the layout
     VkDescriptorSetLayout build(VkDevice device, VkShaderStageFlags shaderStages);
+    // shared layout owned by the cache, identical bindings return the same handle. do not destroy it
+    VkDescriptorSetLayout build(VulkanObjectCache& cache, VkShaderStageFlags shaderStages);
 };
 
 struct DescriptorAllocator {
@@ -28,3 +33,27 @@ struct DescriptorAllocator {
 
     VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout);
 };
+
+// pool of pools: allocations that do not fit move the pool to the full list and continue
+// in a new pool, each new pool 1.5x larger than the last. clear_pools() resets all of them at once
+struct DescriptorAllocatorGrowable {
+public:
+    using PoolSizeRatio = DescriptorAllocator::PoolSizeRatio;
+
+    void init(VkDevice device, uint32_t initialSets, std::span<PoolSizeRatio> poolRatios);
+    void clear_pools(VkDevice device);
+    void destroy_pools(VkDevice device);
+
+    VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout, void* pNext = nullptr);
+
+    size_t pool_count() const { return fullPools.size() + readyPools.size(); }
+
+private:
+    VkDescriptorPool get_pool(VkDevice device);
+    VkDescriptorPool create_pool(VkDevice device, uint32_t setCount, std::span<PoolSizeRatio> poolRatios);
+
+    std::vector<PoolSizeRatio> ratios;
+    std::vector<VkDescriptorPool> fullPools;
+    std::vector<VkDescriptorPool> readyPools;
+    uint32_t setsPerPool;
+};
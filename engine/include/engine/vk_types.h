@@ -27,12 +27,31 @@
 #include <tracy/Tracy.hpp>
 
 
+// what the gpu last did with an image, kept up to date by BarrierBatcher and RenderGraph
+struct ImageState {
+    VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+    // stages of the last use. access holds its writes, or after reads the read accesses
+    // the last write is already visible to
+    VkPipelineStageFlags2 stage{VK_PIPELINE_STAGE_2_NONE};
+    VkAccessFlags2 access{VK_ACCESS_2_NONE};
+    // set when another queue family released the image and it still has to be acquired from there.
+    // layout is then the layout the release started from
+    uint32_t queueFamily{VK_QUEUE_FAMILY_IGNORED};
+};
+
 struct AllocatedImage {
     VkImage image;
     VkImageView imageView;
     VmaAllocation allocation;
     VkExtent3D imageExtent;
     VkFormat imageFormat;
+    ImageState state;
+};
+
+struct AllocatedBuffer {
+    VkBuffer buffer;
+    VmaAllocation allocation;
+    VmaAllocationInfo info;
 };
 
 
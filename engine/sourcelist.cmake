@@ -13,7 +13,41 @@ target_sources(engine PRIVATE
     src/vk_descriptors.cpp
     src/vk_pipelines.h
     src/vk_pipelines.cpp
+    src/vk_profiler.h
+    src/vk_profiler.cpp
+    src/vk_timeline.h
+    src/vk_timeline.cpp
+    src/vk_upload.h
+    src/vk_upload.cpp
+    src/vk_staging_ring.h
+    src/vk_staging_ring.cpp
+    src/vk_pipeline_compiler.h
+    src/vk_pipeline_compiler.cpp
+    src/vk_bindless.h
+    src/vk_bindless.cpp
+    src/vk_object_cache.h
+    src/vk_object_cache.cpp
+    src/vk_render_graph.h
+    src/vk_render_graph.cpp
+    src/vk_barriers.h
+    src/vk_barriers.cpp
+    src/dynamic_resolution.h
+    src/dynamic_resolution.cpp
+    src/job_system.h
+    src/job_system.cpp
+    src/vk_parallel_recorder.h
+    src/vk_parallel_recorder.cpp
+    src/render_packet.h
+    src/render_packet.cpp
+    src/scene.h
+    src/scene.cpp
+    src/gpu_scene.h
+    src/gpu_scene.cpp
     #tracy/Tracy.hpp
     #TracyClient.cpp
     include/engine/vk_types.h
+    include/engine/frame_stats.h
+    include/engine/vk_deletion_queue.h
+    src/vk_deletion_queue.cpp
+    src/frame_stats.cpp
 )
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+void DynamicResolution::configure(const Settings &settings)
+{
+    m_settings = settings;
+    m_settings.minScale = std::clamp(m_settings.minScale, 0.1f, 1.0f);
+    m_settings.maxScale = std::clamp(m_settings.maxScale, m_settings.minScale, 1.0f);
+    m_settings.budgetMs = std::max(m_settings.budgetMs, 0.1f);
+    // disabled renders at the largest allowed scale
+    m_scale = m_settings.enabled ? std::clamp(m_scale, m_settings.minScale, m_settings.maxScale) : m_settings.maxScale;
+}
+
+void DynamicResolution::update(double gpuMs, float renderedScale)
+{
+    if (gpuMs <= 0.0 || renderedScale <= 0.0f)
+    {
+        return;
+    }
+    m_lastMs = gpuMs;
+
+    // what the sampled frame would have cost at full resolution
+    double fullMs = gpuMs / (double(renderedScale) * renderedScale);
+    m_fullResolutionMs = m_samples == 0 ? fullMs : m_fullResolutionMs + (fullMs - m_fullResolutionMs) * m_settings.smoothing;
+    m_samples++;
+
+    if (!m_settings.enabled)
+    {
+        return;
+    }
+
+    // inside the deadband around the budget: keep the scale, small changes are visible and buy nothing
+    double budget = m_settings.budgetMs;
+    if (std::abs(predicted_ms() - budget) <= budget * m_settings.deadband)
+    {
+        return;
+    }
+
+    float ideal = std::clamp((float)std::sqrt(budget / m_fullResolutionMs), m_settings.minScale, m_settings.maxScale);
+    float step = std::clamp(ideal - m_scale, -m_settings.maxStep, m_settings.maxStep);
+    if (std::abs(step) < 0.001f)
+    {
+        return;
+    }
+    m_scale += step;
+    m_changes++;
+
+    // a ramp changes the scale every frame, log it in coarse steps and when it hits a limit
+    bool atLimit = m_scale == m_settings.minScale || m_scale == m_settings.maxScale;
+    if (std::abs(m_scale - m_loggedScale) >= 0.05f || (atLimit && m_scale != m_loggedScale))
+    {
+        spdlog::info("DynamicResolution: scale {:.2f} -> {:.2f}, gpu {:.2f} ms (full resolution {:.2f} ms), budget {:.2f} ms",
+                     m_loggedScale, m_scale, gpuMs, m_fullResolutionMs, budget);
+        m_loggedScale = m_scale;
+    }
+}
+
+VkExtent2D DynamicResolution::scaled_extent(VkExtent2D full) const
+{
+    VkExtent2D extent;
+    extent.width = std::clamp((uint32_t)std::lround(full.width * m_scale), 1u, std::max(full.width, 1u));
+    extent.height = std::clamp((uint32_t)std::lround(full.height * m_scale), 1u, std::max(full.height, 1u));
+    return extent;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+// Dynamic resolution controller.
+// Picks the render scale (per axis) from the measured gpu frame time so the frame fits a budget.
+// Samples are normalized to full resolution with the scale their frame was rendered at, so the
+// frames in flight between a scale change and its first measurement do not make the loop oscillate.
+// Cost is assumed to follow the pixel count (scale^2); fixed costs like the blit and imgui make
+// that slightly pessimistic, the feedback corrects for it.
+class DynamicResolution
+{
+public:
+    struct Settings
+    {
+        bool enabled{false};
+        // gpu time per frame the scale is driven towards
+        float budgetMs{16.0f};
+        float minScale{0.5f};
+        float maxScale{1.0f};
+        // the scale only moves once the predicted time is off the budget by more than this fraction
+        float deadband{0.05f};
+        // largest scale change per sample
+        float maxStep{0.05f};
+        // weight of a new sample in the smoothed full resolution time
+        float smoothing{0.1f};
+
+        bool operator==(const Settings &) const = default;
+    };
+
+    void configure(const Settings &settings);
+    const Settings &settings() const { return m_settings; }
+
+    // gpu time of a finished frame and the scale it was rendered at
+    void update(double gpuMs, float renderedScale);
+
+    float scale() const { return m_scale; }
+    // smoothed gpu time the current scale is predicted to take
+    double predicted_ms() const { return m_fullResolutionMs * m_scale * m_scale; }
+    double last_ms() const { return m_lastMs; }
+    // number of times the scale changed
+    uint32_t changes() const { return m_changes; }
+
+    // part of full to render into at the current scale, at least 1x1
+    VkExtent2D scaled_extent(VkExtent2D full) const;
+
+private:
+    Settings m_settings{};
+    float m_scale{1.0f};
+    double m_fullResolutionMs{0.0};
+    double m_lastMs{0.0};
+    uint32_t m_samples{0};
+    uint32_t m_changes{0};
+    // scale of the last log line, changes are logged in coarse steps
+    float m_loggedScale{1.0f};
+};
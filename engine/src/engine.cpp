@@ -4,7 +4,9 @@
 #include <SDL.h>
 #include <SDL_vulkan.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <thread>
 
 #include "engine/vk_types.h"
@@ -64,55 +66,176 @@ void Swapchain::initSwapchain()
 {
     ZoneScoped;
     spdlog::info("UFMOEngine::init swapchain");
-    createSwapchain(m_vulkanData.windowExtent.width, m_vulkanData.windowExtent.height);
+    if (m_vulkanData.headless)
+    {
+        createOffscreenTargets(m_vulkanData.windowExtent.width, m_vulkanData.windowExtent.height);
+    }
+    else
+    {
+        createSwapchain(m_vulkanData.windowExtent.width, m_vulkanData.windowExtent.height);
+    }
+    createDrawImage(m_vulkanData.drawImage);
+    if (m_vulkanData.asyncCompute)
+    {
+        createDrawImage(m_vulkanData.drawImageAlt);
+    }
+    createDepthImage(m_vulkanData.depthImage);
 }
 
-void Swapchain::createSwapchain(uint32_t width, uint32_t height)
+bool Swapchain::createSwapchain(uint32_t width, uint32_t height)
 {
     //--------------------------
     // Swapchain
     //.........................
     ZoneScoped;
-    spdlog::info("UFMOEngine::create swapchain");
+    spdlog::info("UFMOEngine::create swapchain {}x{}", width, height);
     vkb::SwapchainBuilder swapchainBuilder{m_vulkanData.chosenGPU, m_vulkanData.device, m_vulkanData.surface};
 
     m_data.swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
 
-    vkb::Swapchain vkbSwapchain = swapchainBuilder
+    // present mode from the policy, in order of preference. fifo is always supported and is
+    // what vkbootstrap ends up with when none of the desired modes is
+    switch (m_vulkanData.presentPolicy)
+    {
+    case PresentPolicy::VSync:
+        swapchainBuilder.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+        break;
+    case PresentPolicy::LowLatency:
+        swapchainBuilder.set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
+            .add_fallback_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR)
+            .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+        break;
+    case PresentPolicy::Uncapped:
+        swapchainBuilder.set_desired_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR)
+            .add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
+            .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+        break;
+    }
+
+    // on recreation the old swapchain is handed over, the driver can reuse its resources and
+    // images acquired from it can still be presented
+    auto swapchainRet = swapchainBuilder
                                       //.use_default_format_selection()
                                       .set_desired_format(VkSurfaceFormatKHR{.format = m_data.swapchainImageFormat, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR})
-                                      // use vsync present mode
-                                      //.set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR) //VK_PRESENT_MODE_FIFO_KHR VK_PRESENT_MODE_IMMEDIATE_KHR VK_PRESENT_MODE_MAILBOX_KHR
-                                      /// set_desired_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR)
-                                      .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
                                       .set_desired_extent(width, height)
                                       .set_allocation_callbacks(AllocatorCallback::p_allocatorCallback)
                                       .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-                                      .build()
-                                      .value();
+                                      .set_old_swapchain(m_data.swapchain)
+                                      .build();
+    if (!swapchainRet)
+    {
+        spdlog::error("UFMOEngine::create swapchain failed: {}", swapchainRet.error().message());
+        return false;
+    }
+    vkb::Swapchain vkbSwapchain = swapchainRet.value();
 
     // VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT : can render directly to that image
     // VK_IMAGE_USAGE_TRANSFER_DST_BIT: render to seperate image first (for example for post-processing) and TRANSFER to the swap chain image
 
     m_data.swapchainExtent = vkbSwapchain.extent;
+    m_data.presentMode = vkbSwapchain.present_mode;
+    spdlog::info("UFMOEngine::create swapchain: present mode {}", string_VkPresentModeKHR(m_data.presentMode));
     // store swapchain and its related images
     m_data.swapchain = vkbSwapchain.swapchain;
     m_data.swapchainImages = vkbSwapchain.get_images().value();
+    m_data.swapchainImageStates.assign(m_data.swapchainImages.size(), ImageState{});
     spdlog::debug("UFMOEngine::create swapchain: {} images created", m_data.swapchainImages.size());
     m_data.swapchainImageViews = vkbSwapchain.get_image_views().value();
+    return true;
+}
+
+bool Swapchain::recreateSwapchain(uint32_t width, uint32_t height, DeletionQueue &retireQueue, uint64_t retireValue)
+{
+    ZoneScoped;
+    VkSwapchainKHR oldSwapchain = m_data.swapchain;
+    std::vector<VkImageView> oldImageViews = m_data.swapchainImageViews;
+    if (!createSwapchain(width, height))
+    {
+        // the old swapchain is retired anyway, acquiring from it reports out of date and we try again
+        return false;
+    }
+
+    // frames in flight may still blit into / present the old images, so they go with the last
+    // frame recorded against them instead of a vkDeviceWaitIdle
+    for (VkImageView view : oldImageViews)
+    {
+        retireQueue.push_image_view(view, retireValue);
+    }
+    VkDevice device = m_vulkanData.device;
+    retireQueue.push_function([device, oldSwapchain]()
+                              { vkDestroySwapchainKHR(device, oldSwapchain, nullptr); },
+                              retireValue);
+    return true;
+}
 
+void Swapchain::createOffscreenTargets(uint32_t width, uint32_t height)
+{
+    //--------------------------
+    // Headless targets
+    //.........................
+    // one offscreen image per frame in flight takes the place of the swapchain images,
+    // so draw() keeps doing the same blit + imgui work as in the windowed path.
+    // more frames in flight only add targets, the existing ones keep their contents and state
+    ZoneScoped;
+    const uint32_t first = (uint32_t)m_data.swapchainImages.size();
+    const uint32_t count = std::max(first, m_vulkanData.framesInFlight);
+    if (first == count)
+    {
+        return;
+    }
+    spdlog::info("UFMOEngine::create offscreen targets");
+
+    m_data.swapchain = VK_NULL_HANDLE;
+    m_data.swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    m_data.swapchainExtent = {width, height};
+
+    VkImageUsageFlags targetUsages{};
+    targetUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; // allow readback of the final image
+    targetUsages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    targetUsages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+    VkImageCreateInfo timg_info = vkinit::image_create_info(m_data.swapchainImageFormat, targetUsages, VkExtent3D{width, height, 1});
+
+    VmaAllocationCreateInfo timg_allocinfo = {};
+    timg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    timg_allocinfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    m_data.swapchainImages.resize(count);
+    m_data.swapchainImageStates.resize(count, ImageState{});
+    m_data.swapchainImageViews.resize(count);
+    m_data.offscreenAllocations.resize(count);
+    for (uint32_t i = first; i < count; i++)
+    {
+        VK_CHECK(vmaCreateImage(m_vulkanData.allocator, &timg_info, &timg_allocinfo, &m_data.swapchainImages[i], &m_data.offscreenAllocations[i], nullptr));
+
+        VkImageViewCreateInfo tview_info = vkinit::imageview_create_info(m_data.swapchainImageFormat, m_data.swapchainImages[i], VK_IMAGE_ASPECT_COLOR_BIT);
+        VK_CHECK(vkCreateImageView(m_vulkanData.device, &tview_info, nullptr, &m_data.swapchainImageViews[i]));
+    }
+    spdlog::debug("UFMOEngine::create offscreen targets: {} images created", m_data.swapchainImages.size());
+
+    // the targets have to be gone before the allocator, so they go through the main deletion queue
+    for (size_t i = first; i < count; i++)
+    {
+        m_vulkanData.mainDeletionQueue.push_image_view(m_data.swapchainImageViews[i]);
+        m_vulkanData.mainDeletionQueue.push_image(m_data.swapchainImages[i], m_data.offscreenAllocations[i]);
+    }
+}
+
+void Swapchain::createDrawImage(AllocatedImage &image)
+{
     //------------------------------
     // Images
     //------------------------------
-    // draw image size will match the window
+    // draw image is allocated once at the largest size the window can get, a resize only
+    // changes the drawExtent rendered into it
     VkExtent3D drawImageExtent = {
-        m_vulkanData.windowExtent.width,
-        m_vulkanData.windowExtent.height,
+        m_vulkanData.maxDrawExtent.width,
+        m_vulkanData.maxDrawExtent.height,
         1};
 
     // hardcoding the draw format to 32 bit float
-    m_vulkanData.drawImage.imageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
-    m_vulkanData.drawImage.imageExtent = drawImageExtent;
+    image.imageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    image.imageExtent = drawImageExtent;
 
     VkImageUsageFlags drawImageUsages{};
     drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
@@ -120,7 +243,7 @@ void Swapchain::createSwapchain(uint32_t width, uint32_t height)
     drawImageUsages |= VK_IMAGE_USAGE_STORAGE_BIT;
     drawImageUsages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-    VkImageCreateInfo rimg_info = vkinit::image_create_info(m_vulkanData.drawImage.imageFormat, drawImageUsages, drawImageExtent);
+    VkImageCreateInfo rimg_info = vkinit::image_create_info(image.imageFormat, drawImageUsages, drawImageExtent);
 
     // for the draw image, we want to allocate it from gpu local memory
     VmaAllocationCreateInfo rimg_allocinfo = {};
@@ -129,20 +252,43 @@ void Swapchain::createSwapchain(uint32_t width, uint32_t height)
     rimg_allocinfo.priority = 0;
 
     // allocate and create the image
-    VK_CHECK(vmaCreateImage(m_vulkanData.allocator, &rimg_info, &rimg_allocinfo, &m_vulkanData.drawImage.image, &m_vulkanData.drawImage.allocation, nullptr));
+    VK_CHECK(vmaCreateImage(m_vulkanData.allocator, &rimg_info, &rimg_allocinfo, &image.image, &image.allocation, nullptr));
     
 
     // build a image-view for the draw image to use for rendering
-    VkImageViewCreateInfo rview_info = vkinit::imageview_create_info(m_vulkanData.drawImage.imageFormat, m_vulkanData.drawImage.image, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkImageViewCreateInfo rview_info = vkinit::imageview_create_info(image.imageFormat, image.image, VK_IMAGE_ASPECT_COLOR_BIT);
 
-    VK_CHECK(vkCreateImageView(m_vulkanData.device, &rview_info, nullptr, &m_vulkanData.drawImage.imageView));
+    VK_CHECK(vkCreateImageView(m_vulkanData.device, &rview_info, nullptr, &image.imageView));
 
     // add to deletion queues
-    m_vulkanData.mainDeletionQueue.push_function([=,this]()
-                                                 {
-                                                    
-		vkDestroyImageView(m_vulkanData.device, m_vulkanData.drawImage.imageView, AllocatorCallback::p_allocatorCallback);
-		vmaDestroyImage(m_vulkanData.allocator, m_vulkanData.drawImage.image, m_vulkanData.drawImage.allocation); });
+    m_vulkanData.mainDeletionQueue.push_image_view(image.imageView);
+    m_vulkanData.mainDeletionQueue.push_image(image.image, image.allocation);
+}
+
+void Swapchain::createDepthImage(AllocatedImage &image)
+{
+    // same size as the draw images, the geometry pass renders the drawExtent part of both
+    VkExtent3D depthImageExtent = {
+        m_vulkanData.maxDrawExtent.width,
+        m_vulkanData.maxDrawExtent.height,
+        1};
+
+    image.imageFormat = VK_FORMAT_D32_SFLOAT;
+    image.imageExtent = depthImageExtent;
+
+    VkImageCreateInfo dimg_info = vkinit::image_create_info(image.imageFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImageExtent);
+
+    VmaAllocationCreateInfo dimg_allocinfo = {};
+    dimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    dimg_allocinfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VK_CHECK(vmaCreateImage(m_vulkanData.allocator, &dimg_info, &dimg_allocinfo, &image.image, &image.allocation, nullptr));
+
+    VkImageViewCreateInfo dview_info = vkinit::imageview_create_info(image.imageFormat, image.image, VK_IMAGE_ASPECT_DEPTH_BIT);
+    VK_CHECK(vkCreateImageView(m_vulkanData.device, &dview_info, nullptr, &image.imageView));
+
+    m_vulkanData.mainDeletionQueue.push_image_view(image.imageView);
+    m_vulkanData.mainDeletionQueue.push_image(image.image, image.allocation);
 }
 
 VulkanRenderer &VulkanRenderer::get() { return *loadedEngine; }
@@ -154,32 +300,46 @@ void VulkanRenderer::tearDown()
     if (_isInitialized)
     {
         vkDeviceWaitIdle(vulkanData.device);
-        globalDescriptorAllocator.destroy_pool(vulkanData.device);
+        _recorder.destroy();
+        _gpuProfiler.destroy();
+        _computeProfiler.destroy();
+        _gpuScene.destroy();
+        _uploads.destroy();
+        _stagingRing.destroy();
+        _pipelineCompiler.destroy();
+        _bindless.destroy();
+        // after every pipeline and heap that used the cached layouts
+        _objectCache.destroy();
+        _pipelineCache.save();
+        _pipelineCache.destroy();
+        globalDescriptorAllocator.destroy_pools(vulkanData.device);
+        _frameDeletionQueue.flush();
         vulkanData.mainDeletionQueue.flush();
-        for (int i = 0; i < FRAME_OVERLAP; i++)
-        {
-
-            
-            // VK_CHECK(vkWaitForFences(vulkanData.device, 1, &_frames[i]._renderFence, true, 1000000000));
-            // already written from before
-            vkDestroyCommandPool(vulkanData.device, _frames[i]._commandPool, nullptr);
-
-            // destroy sync objects
-            vkDestroyFence(vulkanData.device, _frames[i]._renderFence, nullptr);
-            vkDestroySemaphore(vulkanData.device, _frames[i]._renderSemaphore, nullptr);
-            vkDestroySemaphore(vulkanData.device, _frames[i]._swapchainSemaphore, nullptr);
-        }
+        // everything allocated through vma is gone now
+        vmaDestroyAllocator(vulkanData.allocator);
+        destroy_frames();
+        _timeline.destroy();
+        _computeTimeline.destroy();
 
         destroySwapchain();
 
-        vkDestroySurfaceKHR(vulkanData.instance, vulkanData.surface, nullptr);
+        if (!vulkanData.headless)
+        {
+            vkDestroySurfaceKHR(vulkanData.instance, vulkanData.surface, nullptr);
+        }
         vkDestroyDevice(vulkanData.device, nullptr);
 
         vkb::destroy_debug_utils_messenger(vulkanData.instance, vulkanData.debug_messenger);
         vkDestroyInstance(vulkanData.instance, nullptr);
-        SDL_DestroyWindow(vulkanData.window);
+        if (vulkanData.window)
+        {
+            SDL_DestroyWindow(vulkanData.window);
+        }
     }
 
+    // after every subsystem that could still have jobs queued
+    _jobs.destroy();
+
     // clear engine pointer
     loadedEngine = nullptr;
 }
@@ -194,6 +354,7 @@ uint8_t VulkanRenderer::initVulkan()
 #if defined(_DEBUG)
     // make the vulkan instance, with basic debug features
     auto inst_ret = builder.set_app_name("Example Vulkan Application")
+                        .set_headless(vulkanData.headless)
                         .request_validation_layers(true)
                         .set_debug_callback(callback)
                         .require_api_version(1, 3, 0)
@@ -204,6 +365,7 @@ uint8_t VulkanRenderer::initVulkan()
 #else
     // make the vulkan instance, with basic debug features
     auto inst_ret = builder.set_app_name("Example Vulkan Application")
+                        .set_headless(vulkanData.headless)
                         .request_validation_layers(false)
                         //.use_default_debug_messenger()
                         .set_debug_callback(callback)
@@ -224,7 +386,10 @@ uint8_t VulkanRenderer::initVulkan()
     // grab the instance
     vulkanData.instance = vkb_inst.instance;
 
-    SDL_Vulkan_CreateSurface(vulkanData.window, vulkanData.instance, &vulkanData.surface);
+    if (!vulkanData.headless)
+    {
+        SDL_Vulkan_CreateSurface(vulkanData.window, vulkanData.instance, &vulkanData.surface);
+    }
 
     // vulkan 1.3 features
     VkPhysicalDeviceVulkan13Features features{};
@@ -235,21 +400,48 @@ uint8_t VulkanRenderer::initVulkan()
     VkPhysicalDeviceVulkan12Features features12{};
     features12.bufferDeviceAddress = true;
     features12.descriptorIndexing = true;
+    // bindless heap: runtime sized, partially bound arrays that are written while bound
+    features12.runtimeDescriptorArray = true;
+    features12.descriptorBindingPartiallyBound = true;
+    features12.descriptorBindingUpdateUnusedWhilePending = true;
+    features12.descriptorBindingSampledImageUpdateAfterBind = true;
+    features12.descriptorBindingStorageImageUpdateAfterBind = true;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = true;
+    features12.shaderSampledImageArrayNonUniformIndexing = true;
+    features12.shaderStorageImageArrayNonUniformIndexing = true;
+    features12.shaderStorageBufferArrayNonUniformIndexing = true;
+    features12.timelineSemaphore = true;
+    // gpu driven rendering: the cull pass writes the draw count
+    features12.drawIndirectCount = true;
 
     // TODO: multi gpu systems
     VkPhysicalDeviceFeatures features10{};
+    // one indirect call for every visible object, firstInstance selects the object
+    features10.multiDrawIndirect = true;
+    features10.drawIndirectFirstInstance = true;
     // features10.samplerAnisotropy = false;
     //  use vkbootstrap to select a gpu.
     //  We want a gpu that can write to the SDL surface and supports vulkan 1.3 with the correct features
     vkb::PhysicalDeviceSelector selector{vkb_inst};
-    vkb::PhysicalDevice physicalDevice = selector
-                                             .set_minimum_version(1, 3)
-                                             .set_required_features_13(features)
-                                             .set_required_features_12(features12)
-                                             //.set_required_features(features10)
-                                             .set_surface(vulkanData.surface)
-                                             .select()
-                                             .value();
+    selector.set_minimum_version(1, 3)
+        .set_required_features_13(features)
+        .set_required_features_12(features12)
+        .set_required_features(features10);
+    if (!vulkanData.headless)
+    {
+        selector.set_surface(vulkanData.surface);
+    }
+    auto physicalDeviceRet = selector.select();
+    if (!physicalDeviceRet)
+    {
+        spdlog::critical("Failed to select a Vulkan device. Error: {} ", physicalDeviceRet.error().message());
+        cpptrace::generate_trace().print();
+        return 1;
+    }
+    vkb::PhysicalDevice physicalDevice = physicalDeviceRet.value();
+
+    // lets the gpu profiler put gpu timestamps on the cpu clock
+    _calibratedTimestamps = physicalDevice.enable_extension_if_present(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
 
     // create the final vulkan device
     vkb::DeviceBuilder deviceBuilder{physicalDevice};
@@ -266,6 +458,46 @@ uint8_t VulkanRenderer::initVulkan()
     _graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
     _graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 
+    // gpu frame timings need timestamps on the graphics queue
+    _timestampPeriod = physicalDevice.properties.limits.timestampPeriod;
+
+    // staging ring allocations may be bound as uniform / storage buffers or used as copy sources
+    const VkPhysicalDeviceLimits &limits = physicalDevice.properties.limits;
+    _stagingAlignment = std::max({VkDeviceSize(16), limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment,
+                                  limits.optimalBufferCopyOffsetAlignment, limits.nonCoherentAtomSize});
+    _timestampValidBits = vkbDevice.queue_families[_graphicsQueueFamily].timestampValidBits;
+
+    // async compute: vkbootstrap hands out a compute family without graphics if the device has one
+    auto computeQueueRet = vkbDevice.get_queue(vkb::QueueType::compute);
+    vulkanData.asyncCompute = _config.asyncCompute && computeQueueRet.has_value();
+    if (vulkanData.asyncCompute)
+    {
+        _computeQueue = computeQueueRet.value();
+        _computeQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::compute).value();
+        spdlog::info("UFMOEngine::init vulkan: async compute on queue family {}", _computeQueueFamily);
+    }
+    else
+    {
+        // no separate family (lavapipe, some integrated gpus): compute passes stay on the graphics queue
+        _computeQueue = _graphicsQueue;
+        _computeQueueFamily = _graphicsQueueFamily;
+        spdlog::info("UFMOEngine::init vulkan: compute passes run on the graphics queue");
+    }
+    _computeTimestampValidBits = vkbDevice.queue_families[_computeQueueFamily].timestampValidBits;
+
+    // uploads: a transfer family without graphics lets copies run next to rendering (dma engine)
+    auto transferQueueRet = vkbDevice.get_queue(vkb::QueueType::transfer);
+    if (transferQueueRet.has_value())
+    {
+        _transferQueue = transferQueueRet.value();
+        _transferQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::transfer).value();
+    }
+    else
+    {
+        _transferQueue = _graphicsQueue;
+        _transferQueueFamily = _graphicsQueueFamily;
+    }
+
     // initialize the memory allocator
     VmaAllocatorCreateInfo allocatorInfo = {};
     allocatorInfo.physicalDevice = vulkanData.chosenGPU;
@@ -275,8 +507,9 @@ uint8_t VulkanRenderer::initVulkan()
     
     vmaCreateAllocator(&allocatorInfo, &vulkanData.allocator);
 
-    vulkanData.mainDeletionQueue.push_function([&]()
-                                               { vmaDestroyAllocator(vulkanData.allocator); });
+    // the allocator itself is destroyed in tearDown() after the queues are flushed
+    vulkanData.mainDeletionQueue.init(vulkanData.device, vulkanData.allocator);
+    _frameDeletionQueue.init(vulkanData.device, vulkanData.allocator);
 
     return 0;
 
@@ -330,17 +563,31 @@ void VulkanRenderer::init_imgui()
     ImGui::CreateContext();
 
     // this initializes imgui for SDL
-    ImGui_ImplSDL2_InitForVulkan(vulkanData.window);
+    // headless: no platform backend, run() feeds display size and delta time itself
+    if (!vulkanData.headless)
+    {
+        ImGui_ImplSDL2_InitForVulkan(vulkanData.window);
+    }
 
     // this initializes imgui for Vulkan
     ImGui_ImplVulkan_InitInfo init_info = {};
     init_info.Instance = vulkanData.instance;
     init_info.PhysicalDevice = vulkanData.chosenGPU;
     init_info.Device = vulkanData.device;
+    init_info.QueueFamily = _graphicsQueueFamily;
     init_info.Queue = _graphicsQueue;
     init_info.DescriptorPool = imguiPool;
-    init_info.MinImageCount = 3;
-    init_info.ImageCount = 3;
+    // MinImageCount is only checked against the swapchain, ImageCount sizes the backend's vertex /
+    // index buffer ring, which has to cover every frame that can be in flight
+    uint32_t minImageCount = 2;
+    if (!vulkanData.headless)
+    {
+        VkSurfaceCapabilitiesKHR surfaceCapabilities;
+        VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vulkanData.chosenGPU, vulkanData.surface, &surfaceCapabilities));
+        minImageCount = std::max(minImageCount, surfaceCapabilities.minImageCount);
+    }
+    init_info.MinImageCount = minImageCount;
+    init_info.ImageCount = std::max(minImageCount, MAX_FRAMES_IN_FLIGHT);
     init_info.UseDynamicRendering = true;
     init_info.PipelineRenderingCreateInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
     init_info.PipelineRenderingCreateInfo.colorAttachmentCount    = 1;
@@ -352,9 +599,9 @@ void VulkanRenderer::init_imgui()
 
     ImGui_ImplVulkan_Init(&init_info);
 
-    // execute a gpu command to upload imgui font textures
-    immediate_submit([&](VkCommandBuffer cmd)
-                     { ImGui_ImplVulkan_CreateFontsTexture(); });
+    // upload imgui font textures. the backend records, submits and waits on its own command buffer,
+    // wrapping it in immediate_submit only added a second empty submit + wait
+    ImGui_ImplVulkan_CreateFontsTexture();
 
     // clear font textures from cpu data
    // ImGui_ImplVulkan_DestroyFontsTexture(); // DestroyFontUploadObjects();
@@ -364,38 +611,78 @@ void VulkanRenderer::init_imgui()
     vulkanData.mainDeletionQueue.push_function([=,this]()
                                                 {		        
         ImGui_ImplVulkan_Shutdown();    
-        ImGui_ImplSDL2_Shutdown();
-        ImGui::DestroyContext();
-		vkDestroyDescriptorPool(vulkanData.device, imguiPool, nullptr);        
-        });
+        if (!vulkanData.headless)
+        {
+            ImGui_ImplSDL2_Shutdown();
+        }
+        ImGui::DestroyContext(); });
+    vulkanData.mainDeletionQueue.push_descriptor_pool(imguiPool);
 }
 
-uint8_t VulkanRenderer::init()
+uint8_t VulkanRenderer::init(const RendererConfig& config)
 {
     IMGUI_CHECKVERSION();
     ZoneScoped;
 #if defined _DEBUG
     spdlog::set_level(spdlog::level::debug);
 #endif
-    spdlog::info("UFMOEngine::init");
+    spdlog::info("UFMOEngine::init{}", config.headless ? " (headless)" : "");
+    auto initStart = std::chrono::steady_clock::now();
     // only one engine initialization is allowed with the application.
     // assert(loadedEngine == nullptr);
     loadedEngine = this;
 
-    // We initialize SDL and create a window with it.
-    SDL_Init(SDL_INIT_VIDEO);
-
-    SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN);
+    _config = config;
+    vulkanData.headless = config.headless;
+    vulkanData.framesInFlight = std::clamp(config.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+    vulkanData.presentPolicy = config.presentPolicy;
+    _frameRateLimit = std::max(config.frameRateLimit, 0.0f);
+    _dynamicResolution.configure(config.dynamicResolution);
+    // the simulation side starts from what the renderer is initialized with
+    _settings = {vulkanData.presentPolicy, vulkanData.framesInFlight, _frameRateLimit, _dynamicResolution.settings()};
+    _renderSettings = _settings;
+    vulkanData.windowExtent = config.windowExtent;
+
+    // before anything that may schedule jobs. external slots for the main and the render thread
+    _jobs.init(config.jobThreads, 2);
+
+    if (!vulkanData.headless)
+    {
+        // We initialize SDL and create a window with it.
+        SDL_Init(SDL_INIT_VIDEO);
+
+        SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+
+        vulkanData.window = SDL_CreateWindow(
+            "Vulkan Engine",
+            SDL_WINDOWPOS_UNDEFINED,
+            SDL_WINDOWPOS_UNDEFINED,
+            vulkanData.windowExtent.width,
+            vulkanData.windowExtent.height,
+            window_flags);
+    }
 
-    vulkanData.window = SDL_CreateWindow(
-        "Vulkan Engine",
-        SDL_WINDOWPOS_UNDEFINED,
-        SDL_WINDOWPOS_UNDEFINED,
-        vulkanData.windowExtent.width,
-        vulkanData.windowExtent.height,
-        window_flags);
+    // the draw images never follow a resize, so they get the largest size up front
+    vulkanData.maxDrawExtent = vulkanData.windowExtent;
+    if (config.maxDrawExtent.width != 0 && config.maxDrawExtent.height != 0)
+    {
+        vulkanData.maxDrawExtent = config.maxDrawExtent;
+    }
+    else if (!vulkanData.headless)
+    {
+        SDL_DisplayMode displayMode;
+        if (SDL_GetDesktopDisplayMode(SDL_GetWindowDisplayIndex(vulkanData.window), &displayMode) == 0)
+        {
+            vulkanData.maxDrawExtent.width = std::max(vulkanData.maxDrawExtent.width, (uint32_t)displayMode.w);
+            vulkanData.maxDrawExtent.height = std::max(vulkanData.maxDrawExtent.height, (uint32_t)displayMode.h);
+        }
+    }
+    spdlog::info("UFMOEngine::init draw image extent {}x{}", vulkanData.maxDrawExtent.width, vulkanData.maxDrawExtent.height);
 
-    initVulkan();
+    if (initVulkan() != 0)
+    {
+        return 1;
+    }
 
     initSwapchain();
 
@@ -403,14 +690,32 @@ uint8_t VulkanRenderer::init()
 
     initSyncStructures();
 
+    init_frames();
+
+    init_recorder();
+
+    init_uploads();
+
+    init_profiler();
+
+    _objectCache.init(vulkanData.device);
+
     init_descriptors();
 
+    init_bindless();
+
+    init_gpu_scene(_config.maxSceneObjects);
+
     init_pipelines();
 
     init_imgui();
 
     // everything went fine
     _isInitialized = true;
+
+    // pipelines may still be compiling, the compiler logs when they are done
+    std::chrono::duration<double, std::milli> initTime = std::chrono::steady_clock::now() - initStart;
+    spdlog::info("UFMOEngine::init finished in {:.2f} ms, {} pipelines still compiling", initTime.count(), _pipelineCompiler.pending());
     
     return 0;
     // spdlog::info("UFMOEngine::init finished");
@@ -420,63 +725,134 @@ uint8_t VulkanRenderer::init()
 
 void VulkanRenderer::init_pipelines()
 {
+    ZoneScoped;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vulkanData.chosenGPU, &properties);
+    _pipelineCache.init(vulkanData.device, properties, _config.pipelineCachePath);
+    _pipelineCompiler.init(vulkanData.device, _pipelineCache.handle(), _jobs, _config.pipelineCompileThreads);
+
     init_background_pipelines();
+    init_geometry_pipelines();
 }
 
 void VulkanRenderer::init_background_pipelines()
 {
-    VkPipelineLayoutCreateInfo computeLayout{};
-    computeLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    computeLayout.pNext = nullptr;
-    computeLayout.pSetLayouts = &_drawImageDescriptorLayout;
-    computeLayout.setLayoutCount = 1;
+    // compiled on a worker, draw_background() clears the draw image until it is ready.
+    // the layout belongs to the bindless heap, the pipeline to the compiler
+    const std::string gradientShaderPath = _config.shaderDirectory + "/gradient.comp.spv";
+    _gradientPipeline = _pipelineCompiler.compile_compute("gradient", gradientShaderPath, _bindless.pipeline_layout());
+}
+
+void VulkanRenderer::init_geometry_pipelines()
+{
+    // the geometry passes are skipped until both are ready
+    const std::string cullShaderPath = _config.shaderDirectory + "/cull.comp.spv";
+    _cullPipeline = _pipelineCompiler.compile_compute("cull", cullShaderPath, _bindless.pipeline_layout());
+
+    const std::string vertexShaderPath = _config.shaderDirectory + "/mesh.vert.spv";
+    const std::string fragmentShaderPath = _config.shaderDirectory + "/mesh.frag.spv";
+    // no vertex input, the vertex shader pulls vertices and objects through buffer device addresses.
+    // the projection flips y, counter clockwise meshes stay counter clockwise on screen.
+    // reverse-z: near is 1, the depth image is cleared to 0
+    PipelineBuilder builder;
+    builder.set_layout(_bindless.pipeline_layout());
+    builder.set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    builder.set_polygon_mode(VK_POLYGON_MODE_FILL);
+    builder.set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+    builder.set_multisampling_none();
+    builder.disable_blending();
+    builder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
+    builder.set_color_attachment_format(vulkanData.drawImage.imageFormat);
+    builder.set_depth_format(vulkanData.depthImage.imageFormat);
+    _meshPipeline = _pipelineCompiler.compile_graphics("mesh", vertexShaderPath, fragmentShaderPath, builder);
+}
 
-    VK_CHECK(vkCreatePipelineLayout(vulkanData.device, &computeLayout, nullptr, &_gradientPipelineLayout));
+void VulkanRenderer::init_gpu_scene(uint32_t maxObjects)
+{
+    ZoneScoped;
+    GpuScene::InitInfo info{};
+    info.device = vulkanData.device;
+    info.allocator = vulkanData.allocator;
+    info.bindless = &_bindless;
+    info.uploads = &_uploads;
+    info.maxObjects = maxObjects;
+    _gpuScene.init(info);
+
+    // destroying an entity (or just its MeshInstance) frees its object
+    _scene.registry().on_destroy<MeshInstance>().connect<&VulkanRenderer::on_mesh_instance_destroyed>(*this);
+}
 
-    // layout code
-    VkShaderModule computeDrawShader;
-    // if (!vkutil::load_shader_module("../../shaders/testapp/gradient.comp.spv", vulkanData.device, &computeDrawShader))
-    if (!vkutil::load_shader_module("O:/projects/dev/UFMO/testapp/shaders/gradient.comp.spv", vulkanData.device, &computeDrawShader))
+bool VulkanRenderer::addMeshInstance(entt::entity entity, uint32_t mesh)
+{
+    if (mesh == GpuScene::INVALID_MESH || _scene.registry().all_of<MeshInstance>(entity))
     {
-        spdlog::error("Error when building shader");
-        abort();
+        return false;
     }
+    uint32_t object;
+    if (!_freeObjects.empty())
+    {
+        object = _freeObjects.back();
+        _freeObjects.pop_back();
+    }
+    else if (_nextObject < _gpuScene.max_objects())
+    {
+        object = _nextObject++;
+    }
+    else
+    {
+        // callers tend to add instances in a loop, one message is enough
+        if (!_objectsFullReported)
+        {
+            spdlog::error("VulkanRenderer: all {} GpuScene objects are in use, raise RendererConfig::maxSceneObjects", _gpuScene.max_objects());
+            _objectsFullReported = true;
+        }
+        return false;
+    }
+    _scene.registry().emplace<MeshInstance>(entity, mesh, object);
+    // the next update recomputes the world matrix, simulate_frame() picks the object up from there
+    _scene.set_local(entity, _scene.local(entity));
+    return true;
+}
 
-    VkPipelineShaderStageCreateInfo stageinfo{};
-    stageinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    stageinfo.pNext = nullptr;
-    stageinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    stageinfo.module = computeDrawShader;
-    stageinfo.pName = "main";
-
-    VkComputePipelineCreateInfo computePipelineCreateInfo{};
-    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    computePipelineCreateInfo.pNext = nullptr;
-    computePipelineCreateInfo.layout = _gradientPipelineLayout;
-    computePipelineCreateInfo.stage = stageinfo;
-
-    VK_CHECK(vkCreateComputePipelines(vulkanData.device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &_gradientPipeline));
-
-    vkDestroyShaderModule(vulkanData.device, computeDrawShader, nullptr);
-
-    vulkanData.mainDeletionQueue.push_function([&]()
-                                               {
-		vkDestroyPipelineLayout(vulkanData.device, _gradientPipelineLayout, nullptr);
-		vkDestroyPipeline(vulkanData.device, _gradientPipeline, nullptr); });
+void VulkanRenderer::on_mesh_instance_destroyed(entt::registry &registry, entt::entity entity)
+{
+    uint32_t object = registry.get<MeshInstance>(entity).object;
+    _objectUpdates.push_back({object, GpuScene::INVALID_MESH, glm::mat4(1.0f)});
+    _freeObjects.push_back(object);
+    _objectsFullReported = false;
 }
 
 void VulkanRenderer::run()
 {
     ZoneScoped;
-    spdlog::info("UFMOEngine::run");
+    spdlog::info("UFMOEngine::run{}", _config.renderThread ? " (render thread)" : "");
     SDL_Event e;
     bool bQuit = false;
-    
+
+    if (_config.collectFrameStats)
+    {
+        _frameStats.enable(_config.statsWarmupFrames);
+    }
+
+    _packets.init(_config.packetQueueDepth);
+    if (_config.renderThread)
+    {
+        _renderThread = std::thread([this]
+                                    { render_loop(); });
+    }
+    // resize events since the last packet
+    bool windowResized = false;
+
     // main loop
     while (!bQuit)
     {
+        if (_config.maxFrames != 0 && _simFrameNumber >= _config.maxFrames)
+        {
+            break;
+        }
+
         // Handle events on queue
-        while (SDL_PollEvent(&e) != 0)
+        while (!vulkanData.headless && SDL_PollEvent(&e) != 0)
         {
             // close the window when user alt-f4s or clicks the X button
             if (e.type == SDL_QUIT)
@@ -492,6 +868,10 @@ void VulkanRenderer::run()
                 {
                     stop_rendering = false;
                 }
+                if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                {
+                    windowResized = true;
+                }
             }
             ImGui_ImplSDL2_ProcessEvent(&e);
         }
@@ -504,25 +884,294 @@ void VulkanRenderer::run()
             continue;
         }
 
-        // imgui new frame
-        
-        ImGui_ImplVulkan_NewFrame();
+        RenderPacket *packet;
+        {
+            // blocks only while packetQueueDepth packets wait for the render thread
+            ZoneScopedN("Wait for Render Thread");
+            packet = _packets.begin_write();
+        }
+        packet->windowResized = windowResized;
+        windowResized = false;
+        simulate_frame(*packet);
+        _packets.submit(packet);
+
+        // no render thread: the packet is drawn right away
+        if (!_renderThread.joinable())
+        {
+            RenderPacket *next = _packets.begin_read();
+            render_packet(*next);
+            _packets.end_read(next);
+        }
+    }
+
+    // the render thread still draws what was submitted before it stops
+    _packets.close();
+    if (_renderThread.joinable())
+    {
+        _renderThread.join();
+    }
+
+    // pick up the gpu timings of the frames still in flight
+    if (_config.collectFrameStats)
+    {
+        vkDeviceWaitIdle(vulkanData.device);
+        for (uint32_t i = 0; i < vulkanData.framesInFlight; i++)
+        {
+            collect_frame_timestamps(i);
+        }
+    }
+}
 
-        //ImGui_ImplVulkan_NewFrame();
+void VulkanRenderer::simulate_frame(RenderPacket &packet)
+{
+    ZoneScoped;
+    packet.frameNumber = _simFrameNumber++;
+    // input for this frame is sampled, latency is measured from here
+    packet.inputTime = std::chrono::steady_clock::now();
+
+    _scene.update(_jobs);
+
+    // removals first, an object freed and reused this frame ends up with the new instance
+    packet.objectUpdates.assign(_objectUpdates.begin(), _objectUpdates.end());
+    _objectUpdates.clear();
+    entt::registry &registry = _scene.registry();
+    _scene.each_changed([&](entt::entity entity, const glm::mat4 &world)
+                        {
+        if (const MeshInstance *instance = registry.try_get<MeshInstance>(entity))
+        {
+            packet.objectUpdates.push_back({instance->object, instance->mesh, world});
+        } });
+    packet.camera = _camera;
+
+    // imgui new frame
+    ImGui_ImplVulkan_NewFrame();
+    if (vulkanData.headless)
+    {
+        ImGuiIO &io = ImGui::GetIO();
+        io.DisplaySize = ImVec2((float)vulkanData.windowExtent.width, (float)vulkanData.windowExtent.height);
+        io.DeltaTime = 1.0f / 60.0f;
+    }
+    else
+    {
         ImGui_ImplSDL2_NewFrame();
-        ImGui::NewFrame();
+    }
+    if (_config.fixedDeltaTime > 0.0f)
+    {
+        ImGui::GetIO().DeltaTime = _config.fixedDeltaTime;
+    }
+    ImGui::NewFrame();
+
+    // some imgui UI to test
+    ImGui::ShowDemoWindow();
+    draw_renderer_settings();
+
+    // make imgui calculate internal draw structures
+    ImGui::Render();
+
+    // imgui reuses its draw lists for the next frame, the render thread gets a copy
+    packet.settings = _settings;
+    packet.ui.capture(ImGui::GetDrawData());
+}
+
+void VulkanRenderer::render_loop()
+{
+    tracy::SetThreadName("Render");
+    // recording jobs can run here while the render thread waits for them
+    _jobs.attach_thread();
+    while (true)
+    {
+        RenderPacket *packet;
+        {
+            ZoneScopedN("Wait for Packet");
+            packet = _packets.begin_read();
+        }
+        if (!packet)
+        {
+            break;
+        }
+        render_packet(*packet);
+        _packets.end_read(packet);
+    }
+    _jobs.detach_thread();
+}
+
+void VulkanRenderer::render_packet(RenderPacket &packet)
+{
+    ZoneScoped;
+    _packet = &packet;
+    apply_settings(packet.settings);
+    if (packet.windowResized)
+    {
+        _swapchainDirty = true;
+    }
+
+    _frameStats.beginFrame();
+    draw();
+    _frameStats.endFrame();
+    _packet = nullptr;
 
-        // some imgui UI to test
-        ImGui::ShowDemoWindow();
+    publish_status();
 
-        // make imgui calculate internal draw structures
-        ImGui::Render();
+    // outside the stats frame, the wait is not work
+    limit_frame_rate();
+}
 
-        draw();
+void VulkanRenderer::apply_settings(const RendererSettings &settings)
+{
+    if (settings.presentPolicy != _renderSettings.presentPolicy)
+    {
+        apply_present_policy(settings.presentPolicy);
+    }
+    if (settings.framesInFlight != _renderSettings.framesInFlight)
+    {
+        // applied by draw(), after the slot's wait
+        _pendingFramesInFlight = settings.framesInFlight;
     }
+    if (settings.frameRateLimit != _renderSettings.frameRateLimit)
+    {
+        _frameRateLimit = settings.frameRateLimit;
+    }
+    if (!(settings.dynamicResolution == _renderSettings.dynamicResolution))
+    {
+        _dynamicResolution.configure(settings.dynamicResolution);
+    }
+    _renderSettings = settings;
 }
+
+void VulkanRenderer::publish_status()
+{
+    std::lock_guard lock(_statusMutex);
+    if (!vulkanData.headless)
+    {
+        _status.presentMode = p_swapchain->getDataRef().presentMode;
+    }
+    _status.drawExtent = vulkanData.drawExtent;
+    _status.renderScale = _dynamicResolution.scale();
+    _status.gpuMs = _dynamicResolution.last_ms();
+    _status.predictedMs = _dynamicResolution.predicted_ms();
+    _status.resolutionChanges = _dynamicResolution.changes();
+    _status.culledPasses = _frameGraph.culled_passes();
+    _status.barrierBatches = _frameGraph.barrier_batches();
+    _status.parallelPasses = _frameGraph.parallel_passes();
+}
+
 void VulkanRenderer::createSwapchain(uint32_t width, uint32_t height)
 {
+    ZoneScoped;
+    // no vkDeviceWaitIdle: the old swapchain retires with the next submitted frame, which
+    // completes after every frame that rendered into or presented its images
+    if (p_swapchain->recreateSwapchain(width, height, _frameDeletionQueue, getRetireValue()))
+    {
+        _swapchainDirty = false;
+    }
+}
+
+void VulkanRenderer::apply_present_policy(PresentPolicy policy)
+{
+    if (policy == vulkanData.presentPolicy)
+    {
+        return;
+    }
+    spdlog::info("UFMOEngine::present policy {} -> {}", (int)vulkanData.presentPolicy, (int)policy);
+    vulkanData.presentPolicy = policy;
+    // the present mode is fixed per swapchain
+    _swapchainDirty = true;
+}
+
+void VulkanRenderer::limit_frame_rate()
+{
+    if (_frameRateLimit <= 0.0f)
+    {
+        _nextFrameTime = {};
+        return;
+    }
+    ZoneScopedN("Frame Limiter");
+    using clock = std::chrono::steady_clock;
+    const auto frameTime = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / _frameRateLimit));
+    const auto now = clock::now();
+
+    // deadlines advance by whole frame times, so the average rate stays exact.
+    // a frame that ran late moves the deadline instead of bursting to catch up
+    _nextFrameTime += frameTime;
+    if (_nextFrameTime <= now)
+    {
+        _nextFrameTime = now;
+        return;
+    }
+
+    // sleeps can overshoot by a scheduler tick, sleep most of the way and yield the rest
+    const auto sleepUntil = _nextFrameTime - std::chrono::milliseconds(2);
+    if (now < sleepUntil)
+    {
+        std::this_thread::sleep_until(sleepUntil);
+    }
+    while (clock::now() < _nextFrameTime)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void VulkanRenderer::draw_renderer_settings()
+{
+    RendererStatus status;
+    {
+        std::lock_guard lock(_statusMutex);
+        status = _status;
+    }
+    if (ImGui::Begin("Renderer"))
+    {
+        if (!vulkanData.headless)
+        {
+            const char *policies[] = {"VSync (fifo)", "Low latency (mailbox)", "Uncapped (immediate)"};
+            int policy = (int)_settings.presentPolicy;
+            if (ImGui::Combo("Present policy", &policy, policies, IM_ARRAYSIZE(policies)))
+            {
+                setPresentPolicy((PresentPolicy)policy);
+            }
+            ImGui::Text("present mode: %s", string_VkPresentModeKHR(status.presentMode));
+        }
+        int framesInFlight = (int)_settings.framesInFlight;
+        if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, (int)MAX_FRAMES_IN_FLIGHT))
+        {
+            setFramesInFlight((uint32_t)framesInFlight);
+        }
+        float limit = _settings.frameRateLimit;
+        if (ImGui::SliderFloat("Frame limit", &limit, 0.0f, 500.0f, limit > 0.0f ? "%.0f fps" : "off"))
+        {
+            setFrameRateLimit(limit);
+        }
+
+        ImGui::SeparatorText("Dynamic resolution");
+        DynamicResolution::Settings settings = _settings.dynamicResolution;
+        bool changed = ImGui::Checkbox("Enabled", &settings.enabled);
+        changed |= ImGui::SliderFloat("GPU budget", &settings.budgetMs, 1.0f, 50.0f, "%.1f ms");
+        changed |= ImGui::DragFloatRange2("Scale", &settings.minScale, &settings.maxScale, 0.01f, 0.1f, 1.0f, "min %.2f", "max %.2f");
+        if (changed)
+        {
+            setDynamicResolution(settings);
+        }
+        ImGui::Text("scale %.2f, %ux%u", status.renderScale, status.drawExtent.width, status.drawExtent.height);
+        ImGui::Text("gpu %.2f ms, predicted %.2f ms, %u changes", status.gpuMs, status.predictedMs, status.resolutionChanges);
+
+        ImGui::SeparatorText("Frame graph");
+        ImGui::Text("%u culled, %u barrier batches, %u recorded in parallel", status.culledPasses, status.barrierBatches, status.parallelPasses);
+    }
+    ImGui::End();
+}
+
+bool VulkanRenderer::resize_swapchain()
+{
+    int width = 0;
+    int height = 0;
+    SDL_Vulkan_GetDrawableSize(vulkanData.window, &width, &height);
+    if (width == 0 || height == 0)
+    {
+        // minimized, keep the old swapchain until there is something to show
+        return false;
+    }
+    vulkanData.windowExtent = {(uint32_t)width, (uint32_t)height};
+    createSwapchain(vulkanData.windowExtent.width, vulkanData.windowExtent.height);
+    return !_swapchainDirty;
 }
 
 void VulkanRenderer::initSwapchain()
@@ -538,6 +1187,12 @@ void VulkanRenderer::initSwapchain()
 void VulkanRenderer::destroySwapchain()
 {
     ZoneScoped;
+    // headless targets are owned by the main deletion queue
+    if (p_swapchain->getDataRef().swapchain == VK_NULL_HANDLE)
+    {
+        p_swapchain.reset(nullptr);
+        return;
+    }
     // TODO: delegate destroy to swapchain class
     vkDestroySwapchainKHR(vulkanData.device, p_swapchain->getDataRef().swapchain, nullptr);
 
@@ -564,21 +1219,7 @@ void VulkanRenderer::initCommands()
     commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;//VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     commandPoolInfo.queueFamilyIndex = _graphicsQueueFamily;
 
-    for (int i = 0; i < FRAME_OVERLAP; i++)
-    {
-
-        VK_CHECK(vkCreateCommandPool(vulkanData.device, &commandPoolInfo, nullptr, &_frames[i]._commandPool));
-
-        // allocate the default command buffer that we will use for rendering
-        VkCommandBufferAllocateInfo cmdAllocInfo = {};
-        cmdAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        cmdAllocInfo.pNext = nullptr;
-        cmdAllocInfo.commandPool = _frames[i]._commandPool;
-        cmdAllocInfo.commandBufferCount = 1;
-        cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-        VK_CHECK(vkAllocateCommandBuffers(vulkanData.device, &cmdAllocInfo, &_frames[i]._mainCommandBuffer));
-    }
+    // the per frame pools are created in init_frames()
 
     // immidiate
     VK_CHECK(vkCreateCommandPool(vulkanData.device, &commandPoolInfo, nullptr, &_immCommandPool));
@@ -588,8 +1229,7 @@ void VulkanRenderer::initCommands()
 
     VK_CHECK(vkAllocateCommandBuffers(vulkanData.device, &cmdAllocInfo, &_immCommandBuffer));
 
-    vulkanData.mainDeletionQueue.push_function([=,this]()
-                                               { vkDestroyCommandPool(vulkanData.device, _immCommandPool, nullptr); });
+    vulkanData.mainDeletionQueue.push_command_pool(_immCommandPool);
 }
 
 void VulkanRenderer::initSyncStructures()
@@ -597,30 +1237,154 @@ void VulkanRenderer::initSyncStructures()
     ZoneScoped;
     spdlog::info("UFMOEngine::init sync structures");
     // create syncronization structures
-    // one fence to control when the gpu has finished rendering the frame,
-    // and 2 semaphores to syncronize rendering with swapchain
-    // we want the fence to start signalled so we can wait on it on the first frame
+    // one device timeline semaphore tracks when the gpu has finished any submission (frames, uploads),
+    // and 2 binary semaphores per frame syncronize rendering with the swapchain
+    // (presentation cannot wait on timeline semaphores)
+    _timeline.init(vulkanData.device);
+    // async compute signals a timeline of its own, graphics waits on it before reading the draw image
+    _computeTimeline.init(vulkanData.device);
+    // the binary semaphores belong to the frame slots, see init_frames()
+}
 
-    VkFenceCreateInfo fenceCreateInfo = vkinit::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
+void VulkanRenderer::init_frames()
+{
+    ZoneScoped;
+    spdlog::info("UFMOEngine::init {} frames in flight", vulkanData.framesInFlight);
+    _frames.resize(vulkanData.framesInFlight);
+
+    VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    // the compute command buffers have to come from pools of the compute family
+    VkCommandPoolCreateInfo computePoolInfo = vkinit::command_pool_create_info(_computeQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
     VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphore_create_info();
 
-    for (int i = 0; i < FRAME_OVERLAP; i++)
+    // per-frame allocators, grow on demand and get reset at the start of their frame
+    std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> frameSizes = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+    };
+
+    for (FrameData &frame : _frames)
     {
-        VK_CHECK(vkCreateFence(vulkanData.device, &fenceCreateInfo, VK_NULL_HANDLE, &_frames[i]._renderFence));
+        // allocate the default command buffer that we will use for rendering
+        VK_CHECK(vkCreateCommandPool(vulkanData.device, &commandPoolInfo, nullptr, &frame._commandPool));
+        VkCommandBufferAllocateInfo cmdAllocInfo = vkinit::command_buffer_allocate_info(frame._commandPool, 1);
+        VK_CHECK(vkAllocateCommandBuffers(vulkanData.device, &cmdAllocInfo, &frame._mainCommandBuffer));
+
+        if (vulkanData.asyncCompute)
+        {
+            VK_CHECK(vkCreateCommandPool(vulkanData.device, &computePoolInfo, nullptr, &frame._computeCommandPool));
+            VkCommandBufferAllocateInfo computeAllocInfo = vkinit::command_buffer_allocate_info(frame._computeCommandPool, 1);
+            VK_CHECK(vkAllocateCommandBuffers(vulkanData.device, &computeAllocInfo, &frame._computeCommandBuffer));
+        }
+
+        // nothing submitted yet, value 0 is already reached
+        frame._timelineValue = 0;
+        VK_CHECK(vkCreateSemaphore(vulkanData.device, &semaphoreCreateInfo, VK_NULL_HANDLE, &frame._swapchainSemaphore));
+        VK_CHECK(vkCreateSemaphore(vulkanData.device, &semaphoreCreateInfo, VK_NULL_HANDLE, &frame._renderSemaphore));
 
-        VK_CHECK(vkCreateSemaphore(vulkanData.device, &semaphoreCreateInfo, VK_NULL_HANDLE, &_frames[i]._swapchainSemaphore));
-        VK_CHECK(vkCreateSemaphore(vulkanData.device, &semaphoreCreateInfo, VK_NULL_HANDLE, &_frames[i]._renderSemaphore));
+        frame._frameDescriptors.init(vulkanData.device, 1000, frameSizes);
     }
+}
 
-    // immidiate
-    VK_CHECK(vkCreateFence(vulkanData.device, &fenceCreateInfo, nullptr, &_immFence));
-    vulkanData.mainDeletionQueue.push_function([=,this]()
-                                               { vkDestroyFence(vulkanData.device, _immFence, nullptr); });
+void VulkanRenderer::destroy_frames()
+{
+    for (FrameData &frame : _frames)
+    {
+        vkDestroyCommandPool(vulkanData.device, frame._commandPool, nullptr);
+        vkDestroyCommandPool(vulkanData.device, frame._computeCommandPool, nullptr);
+        frame._frameDescriptors.destroy_pools(vulkanData.device);
+
+        // destroy sync objects
+        vkDestroySemaphore(vulkanData.device, frame._renderSemaphore, nullptr);
+        vkDestroySemaphore(vulkanData.device, frame._swapchainSemaphore, nullptr);
+    }
+    _frames.clear();
+}
+
+void VulkanRenderer::init_recorder()
+{
+    ZoneScoped;
+    ParallelRecorder::InitInfo recorderInfo{};
+    recorderInfo.device = vulkanData.device;
+    recorderInfo.queueFamily = _graphicsQueueFamily;
+    // pools for every possible slot, changing the frames in flight leaves them alone
+    recorderInfo.frameSlots = MAX_FRAMES_IN_FLIGHT;
+    recorderInfo.jobs = &_jobs;
+    _recorder.init(recorderInfo);
+
+    // secondaries start without bound descriptors, the frame graph's passes expect the heap
+    _frameGraph.set_parallel_recorder(&_recorder, [this](VkCommandBuffer cmd)
+                                      {
+                                          _bindless.bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+                                          _bindless.bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS); });
+}
+
+void VulkanRenderer::apply_frames_in_flight()
+{
+    ZoneScoped;
+    uint32_t count = _pendingFramesInFlight;
+    _pendingFramesInFlight = 0;
+    if (count == vulkanData.framesInFlight)
+    {
+        return;
+    }
+    spdlog::info("UFMOEngine::frames in flight {} -> {}", vulkanData.framesInFlight, count);
+
+    // drain: command buffers, semaphores and staging memory of every slot may still be in use.
+    // a full wait is fine here, the setting changes on request and not per frame
+    VK_CHECK(vkDeviceWaitIdle(vulkanData.device));
+    for (uint32_t i = 0; i < vulkanData.framesInFlight; i++)
+    {
+        collect_frame_timestamps(i);
+    }
+    _frameDeletionQueue.flush(_timeline.completed_value());
+
+    // rebuild: the slots start over with nothing submitted
+    destroy_frames();
+    vulkanData.framesInFlight = count;
+    init_frames();
+    _stagingRing.resize(count);
+    if (vulkanData.headless)
+    {
+        p_swapchain->createOffscreenTargets(vulkanData.windowExtent.width, vulkanData.windowExtent.height);
+    }
+}
+
+void VulkanRenderer::init_uploads()
+{
+    ZoneScoped;
+    UploadContext::InitInfo uploadInfo{};
+    uploadInfo.device = vulkanData.device;
+    uploadInfo.allocator = vulkanData.allocator;
+    uploadInfo.queue = _transferQueue;
+    uploadInfo.queueFamily = _transferQueueFamily;
+    uploadInfo.graphicsQueueFamily = _graphicsQueueFamily;
+    _uploads.init(uploadInfo);
+
+    StagingRing::InitInfo ringInfo{};
+    ringInfo.device = vulkanData.device;
+    ringInfo.allocator = vulkanData.allocator;
+    ringInfo.timeline = &_timeline;
+    ringInfo.frameSlots = vulkanData.framesInFlight;
+    ringInfo.slotSize = get_aligned(_config.stagingRingSize, _stagingAlignment);
+    ringInfo.minAlignment = _stagingAlignment;
+    _stagingRing.init(ringInfo);
+}
+
+AllocatedBuffer VulkanRenderer::create_buffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage)
+{
+    return vkutil::create_buffer(vulkanData.allocator, allocSize, usage, memoryUsage);
+}
+
+void VulkanRenderer::destroy_buffer(const AllocatedBuffer &buffer)
+{
+    vkutil::destroy_buffer(vulkanData.allocator, buffer);
 }
 
 void VulkanRenderer::immediate_submit(std::function<void(VkCommandBuffer cmd)> &&function)
 {
-    VK_CHECK(vkResetFences(vulkanData.device, 1, &_immFence));
     VK_CHECK(vkResetCommandBuffer(_immCommandBuffer, 0));
 
     VkCommandBuffer cmd = _immCommandBuffer;
@@ -634,13 +1398,15 @@ void VulkanRenderer::immediate_submit(std::function<void(VkCommandBuffer cmd)> &
     VK_CHECK(vkEndCommandBuffer(cmd));
 
     VkCommandBufferSubmitInfo cmdinfo = vkinit::command_buffer_submit_info(cmd);
-    VkSubmitInfo2 submit = vkinit::submit_info(&cmdinfo, nullptr, nullptr);
 
     // submit command buffer to the queue and execute it.
-    //  _renderFence will now block until the graphic commands finish execution
-    VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, _immFence));
+    //  the timeline value will be reached once the commands finished execution
+    uint64_t value = _timeline.next_value();
+    VkSemaphoreSubmitInfo timelineSignal = _timeline.signal_info(value);
+    VkSubmitInfo2 submit = vkinit::submit_info(&cmdinfo, &timelineSignal, nullptr);
+    VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, VK_NULL_HANDLE));
 
-    VK_CHECK(vkWaitForFences(vulkanData.device, 1, &_immFence, true, 9999999999));
+    VK_CHECK(_timeline.wait(value, 9999999999));
 }
 
 void VulkanRenderer::draw_background(VkCommandBuffer cmd)
@@ -649,26 +1415,272 @@ void VulkanRenderer::draw_background(VkCommandBuffer cmd)
     VkClearColorValue clearValue;
     float flash = abs(sin(_frameNumber / 120.f));
     flash = 1.0;
-    // clearValue = {{0.0f, 0.0f, flash, 1.0f}};
+    clearValue = {{0.0f, 0.0f, flash, 1.0f}};
+
+    VkImageSubresourceRange clearRange = vkinit::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // the gradient pipeline is still compiling (or failed), clear instead
+    if (!_gradientPipeline.ready())
+    {
+        vkCmdClearColorImage(cmd, vulkanData.drawImage.image, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &clearRange);
+        return;
+    }
 
     // bind the gradient drawing compute pipeline
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipeline);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipeline.get());
 
-    // bind the descriptor set containing the draw image for the compute pipeline
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipelineLayout, 0, 1, &_drawImageDescriptors, 0, nullptr);
+    // the bindless heap is already bound for this command buffer, the shader only needs the draw image's
+    // slot and the part of it this frame renders
+    struct
+    {
+        uint32_t targetImage;
+        uint32_t width;
+        uint32_t height;
+    } constants{_drawImageIndex, vulkanData.drawExtent.width, vulkanData.drawExtent.height};
+    vkCmdPushConstants(cmd, _bindless.pipeline_layout(), VK_SHADER_STAGE_ALL, 0, sizeof(constants), &constants);
 
     // execute the compute pipeline dispatch. We are using 16x16 workgroup size so we need to divide by it
     vkCmdDispatch(cmd, std::ceil(vulkanData.drawExtent.width / 16.0), std::ceil(vulkanData.drawExtent.height / 16.0), 1);
+}
 
-    VkImageSubresourceRange clearRange = vkinit::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+uint64_t VulkanRenderer::submit_async_compute()
+{
+    ZoneScoped;
+    FrameData &frame = get_current_frame();
+
+    // ping-pong the draw images: compute writes the one the frame before last read,
+    // while the previous frame may still be blitting the other one
+    std::swap(vulkanData.drawImage, vulkanData.drawImageAlt);
+    std::swap(_drawImageIndex, _drawImageAltIndex);
+    std::swap(_drawImageLastUse, _drawImageAltLastUse);
+
+    // the slot's previous compute work is done, the graphics frame we waited on in draw() waited on it
+    VK_CHECK(vkResetCommandPool(vulkanData.device, frame._computeCommandPool, 0));
+    VkCommandBuffer cmd = frame._computeCommandBuffer;
+
+    VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+    _computeProfiler.begin_frame(cmd, get_frame_slot());
+
+    // compute-only command buffer, so only the compute bind point
+    _bindless.bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    // old contents are discarded, so there is nothing to acquire from the graphics family.
+    // the semaphore wait below happens at the compute stage, the discard chains onto it
+    _computeGraph.begin(_computeQueueFamily);
+    RenderGraph::Resource drawImage = _computeGraph.import_image("draw image", vulkanData.drawImage);
+    _computeGraph.discard(drawImage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    add_background_pass(_computeGraph, drawImage);
+    // release half of the ownership transfer, the graphics frame graph records the matching acquire
+    // for its first use of the draw image
+    RenderGraph::Usage graphicsUsage = _drawGeometry ? RenderGraph::Usage::ColorAttachment : RenderGraph::Usage::BlitSrc;
+    _computeGraph.export_resource(drawImage, graphicsUsage, _graphicsQueueFamily);
+    _computeGraph.execute(cmd, &_computeProfiler);
+
+    _computeProfiler.end_frame(cmd);
+
+    VK_CHECK(vkEndCommandBuffer(cmd));
+
+    // wait until graphics finished reading this draw image (value 0 on the first frames is already reached)
+    VkCommandBufferSubmitInfo cmdinfo = vkinit::command_buffer_submit_info(cmd);
+    VkSemaphoreSubmitInfo waitInfo = _timeline.wait_info(_drawImageLastUse, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    uint64_t computeValue = _computeTimeline.next_value();
+    VkSemaphoreSubmitInfo signalInfo = _computeTimeline.signal_info(computeValue);
 
-    // clear image
-    // vkCmdClearColorImage(cmd, vulkanData.drawImage.image, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &clearRange);
+    VkSubmitInfo2 submit = vkinit::submit_info(&cmdinfo, std::span(&signalInfo, 1), std::span(&waitInfo, 1));
+    VK_CHECK(vkQueueSubmit2(_computeQueue, 1, &submit, VK_NULL_HANDLE));
+
+    return computeValue;
+}
+
+void VulkanRenderer::add_background_pass(RenderGraph &graph, RenderGraph::Resource drawImage)
+{
+    // the background is a dispatch, or a clear while its pipeline is compiling
+    RenderGraph::Usage usage = _gradientPipeline.ready() ? RenderGraph::Usage::ComputeWrite : RenderGraph::Usage::Clear;
+    graph.add_pass("Background", [this](VkCommandBuffer cmd)
+                   { draw_background(cmd); })
+        .write(drawImage, usage);
+}
+
+void VulkanRenderer::add_geometry_passes(RenderGraph &graph, RenderGraph::Resource drawImage)
+{
+    // the scene buffers are not tracked, the previous frame's uses are the hazards of the first use here
+    RenderGraph::Resource objects = graph.import_buffer("objects", _gpuScene.objects().buffer,
+                                                        {.stage = VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+                                                         .access = VK_ACCESS_2_TRANSFER_WRITE_BIT});
+
+    // changes have to land even while the pipelines are compiling
+    if (_gpuScene.has_object_copies())
+    {
+        graph.add_pass("Upload Objects", [this](VkCommandBuffer cmd)
+                       { _gpuScene.record_object_copies(cmd); })
+            .write(objects, RenderGraph::Usage::CopyDst)
+            .side_effect();
+    }
+    if (!_drawGeometry)
+    {
+        return;
+    }
+
+    RenderGraph::Resource draws = graph.import_buffer("draws", _gpuScene.draws().buffer,
+                                                      {.stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                                                       .access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT});
+    RenderGraph::Resource drawCount = graph.import_buffer("draw count", _gpuScene.draw_count().buffer,
+                                                          {.stage = VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                                                           .access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT});
+    // cleared by the geometry pass, the previous frame's depth is not needed
+    RenderGraph::Resource depth = graph.import_image("depth image", vulkanData.depthImage);
+    graph.discard(depth);
+
+    // the aspect ratio follows drawExtent. infinite reverse-z perspective, y flipped for vulkan
+    const Camera &camera = _packet->camera;
+    float aspect = (float)vulkanData.drawExtent.width / (float)vulkanData.drawExtent.height;
+    float focal = 1.0f / std::tan(camera.fovY * 0.5f);
+    glm::mat4 projection(0.0f);
+    projection[0][0] = focal / aspect;
+    projection[1][1] = -focal;
+    projection[2][3] = -1.0f;
+    projection[3][2] = camera.nearPlane;
+    _viewProjection = projection * camera.view;
+
+    graph.add_pass("Reset Draw Count", [this](VkCommandBuffer cmd)
+                   { vkCmdFillBuffer(cmd, _gpuScene.draw_count().buffer, 0, sizeof(uint32_t), 0); })
+        .write(drawCount, RenderGraph::Usage::Clear);
+
+    graph.add_pass("Cull", [this](VkCommandBuffer cmd)
+                   { draw_cull(cmd); })
+        .read(objects, RenderGraph::Usage::ComputeRead)
+        .write(draws, RenderGraph::Usage::ComputeWrite)
+        .write(drawCount, RenderGraph::Usage::ComputeReadWrite);
+
+    graph.add_pass("Geometry", [this](VkCommandBuffer cmd)
+                   { draw_geometry(cmd); })
+        .read(draws, RenderGraph::Usage::IndirectRead)
+        .read(drawCount, RenderGraph::Usage::IndirectRead)
+        .read(objects, RenderGraph::Usage::VertexRead)
+        .write(drawImage, RenderGraph::Usage::ColorAttachment)
+        .write(depth, RenderGraph::Usage::DepthAttachment);
+}
+
+void VulkanRenderer::draw_cull(VkCommandBuffer cmd)
+{
+    // frustum planes from the rows of the view projection (gribb / hartmann), normals point inwards.
+    // the far plane of the infinite projection has no normal, it is replaced by one that keeps everything
+    glm::mat4 rows = glm::transpose(_viewProjection);
+    struct CullConstants
+    {
+        glm::vec4 planes[6];
+        uint32_t meshes;
+        uint32_t objects;
+        uint32_t draws;
+        uint32_t drawCount;
+        uint32_t objectCount;
+    } constants{};
+    constants.planes[0] = rows[3] + rows[0];
+    constants.planes[1] = rows[3] - rows[0];
+    constants.planes[2] = rows[3] + rows[1];
+    constants.planes[3] = rows[3] - rows[1];
+    constants.planes[4] = rows[3] - rows[2];
+    constants.planes[5] = rows[2];
+    for (glm::vec4 &plane : constants.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        plane = length > 1e-6f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    constants.meshes = _gpuScene.meshes_index();
+    constants.objects = _gpuScene.objects_index();
+    constants.draws = _gpuScene.draws_index();
+    constants.drawCount = _gpuScene.draw_count_index();
+    constants.objectCount = _gpuScene.object_count();
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline.get());
+    vkCmdPushConstants(cmd, _bindless.pipeline_layout(), VK_SHADER_STAGE_ALL, 0, sizeof(constants), &constants);
+    // 64 objects per workgroup
+    vkCmdDispatch(cmd, (constants.objectCount + 63) / 64, 1, 1);
+}
+
+void VulkanRenderer::draw_geometry(VkCommandBuffer cmd)
+{
+    VkRenderingAttachmentInfo colorAttachment = vkinit::attachment_info(vulkanData.drawImage.imageView, nullptr);
+    VkRenderingAttachmentInfo depthAttachment = vkinit::depth_attachment_info(vulkanData.depthImage.imageView);
+    VkRenderingInfo renderInfo = vkinit::rendering_info(vulkanData.drawExtent, &colorAttachment, &depthAttachment);
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _meshPipeline.get());
+
+    VkViewport viewport{};
+    viewport.width = (float)vulkanData.drawExtent.width;
+    viewport.height = (float)vulkanData.drawExtent.height;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    VkRect2D scissor{{0, 0}, vulkanData.drawExtent};
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    // no vertex buffers to bind, the shader reads through the addresses
+    struct MeshConstants
+    {
+        glm::mat4 viewProjection;
+        VkDeviceAddress vertices;
+        VkDeviceAddress objects;
+    } constants{_viewProjection, _gpuScene.vertices_address(), _gpuScene.objects_address()};
+    vkCmdPushConstants(cmd, _bindless.pipeline_layout(), VK_SHADER_STAGE_ALL, 0, sizeof(constants), &constants);
+
+    // every visible object in one call, the cull pass wrote the commands and their count
+    vkCmdBindIndexBuffer(cmd, _gpuScene.indices().buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexedIndirectCount(cmd, _gpuScene.draws().buffer, 0, _gpuScene.draw_count().buffer, 0,
+                                  _gpuScene.max_objects(), sizeof(VkDrawIndexedIndirectCommand));
+
+    vkCmdEndRendering(cmd);
+}
+
+void VulkanRenderer::record_frame_graph(VkCommandBuffer cmd, uint32_t swapchainImageIndex)
+{
+    ZoneScoped;
+    SwapchainData &swapchain = p_swapchain->getDataRef();
+    _frameGraph.begin(_graphicsQueueFamily);
+
+    // async compute: the tracked state still names the compute family, so the graph records the
+    // acquire half of the transfer released by submit_async_compute(). the submit waits on the
+    // compute timeline at the geometry pass's color output or at the blit stage
+    RenderGraph::Resource drawImage = _frameGraph.import_image("draw image", vulkanData.drawImage);
+
+    // the blit overwrites the whole target. windowed, the acquire semaphore is waited on at
+    // color attachment output and the first use chains onto that
+    RenderGraph::Resource target = _frameGraph.import_image("swapchain image", swapchain.swapchainImages[swapchainImageIndex],
+                                                            swapchain.swapchainImageStates[swapchainImageIndex]);
+    _frameGraph.discard(target, vulkanData.headless ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+    if (!vulkanData.asyncCompute)
+    {
+        // the background overwrites the draw image, the previous frame's blit was the last reader
+        _frameGraph.discard(drawImage);
+        add_background_pass(_frameGraph, drawImage);
+    }
+
+    add_geometry_passes(_frameGraph, drawImage);
+
+    // execute a copy from the draw image into the swapchain
+    _frameGraph.add_pass("Blit", [this, &swapchain, swapchainImageIndex](VkCommandBuffer cmd)
+                         { vkutil::copy_image_to_image(cmd, vulkanData.drawImage.image, swapchain.swapchainImages[swapchainImageIndex],
+                                                       vulkanData.drawExtent, swapchain.swapchainExtent); })
+        .read(drawImage, RenderGraph::Usage::BlitSrc)
+        .write(target, RenderGraph::Usage::BlitDst);
+
+    // draw imgui into the swapchain image
+    _frameGraph.add_pass("ImGui", [this, &swapchain, swapchainImageIndex](VkCommandBuffer cmd)
+                         { draw_imgui(cmd, swapchain.swapchainImageViews[swapchainImageIndex]); })
+        .write(target, RenderGraph::Usage::ColorAttachment);
+
+    // headless: there is no presentation engine, leave the target ready for readback
+    _frameGraph.export_resource(target, vulkanData.headless ? RenderGraph::Usage::CopySrc : RenderGraph::Usage::Present);
+
+    _frameGraph.execute(cmd, &_gpuProfiler);
 }
 
 void VulkanRenderer::draw_imgui(VkCommandBuffer cmd, VkImageView targetImageView)
 {
-	VkRenderingAttachmentInfo colorAttachment = vkinit::attachment_info(targetImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL);
+	VkRenderingAttachmentInfo colorAttachment = vkinit::attachment_info(targetImageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	VkRenderingInfo renderInfo {};//= vkinit::rendering_info(_swapchainExtent, &colorAttachment, nullptr);
 
     renderInfo.colorAttachmentCount = 1;
@@ -681,7 +1693,11 @@ void VulkanRenderer::draw_imgui(VkCommandBuffer cmd, VkImageView targetImageView
 
 	vkCmdBeginRendering(cmd, &renderInfo);
 
-	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+	// the packet's copy, imgui itself is already building the next frame
+	if (ImDrawData *drawData = _packet->ui.draw_data())
+	{
+		ImGui_ImplVulkan_RenderDrawData(drawData, cmd);
+	}
 
 	vkCmdEndRendering(cmd);
 }
@@ -690,23 +1706,94 @@ void VulkanRenderer::draw_imgui(VkCommandBuffer cmd, VkImageView targetImageView
 void VulkanRenderer::draw()
 {
     ZoneScoped;
-    // spdlog::debug("...{}",_frameNumber % FRAME_OVERLAP);
+    if (_pendingFramesInFlight != 0)
+    {
+        apply_frames_in_flight();
+    }
 
     // request image from the swapchain
     uint32_t swapchainImageIndex;
 
     // if ( int i = VK_TIMOUT );
     {
-        ZoneScopedN("Wait for Fence");
-        VK_CHECK(vkWaitForFences(vulkanData.device, 1, &get_current_frame()._renderFence, true, 1000000000));
+        // zone name kept for benchmark continuity, this waits on the slot's timeline value
+        StatsZoneScopedN(_frameStats, "Wait for Fence");
+        VK_CHECK(_timeline.wait(get_current_frame()._timelineValue, 1000000000));
+
+        collect_frame_timestamps(get_frame_slot());
+        get_current_frame()._cpuBeginTime = _packet->inputTime;
+        // anything retired by a finished submission (older frames, uploads) can go
+        _frameDeletionQueue.flush(_timeline.completed_value());
+        _uploads.collect();
+        _bindless.collect(_timeline.completed_value());
+        _stagingRing.begin_frame(get_frame_slot());
+        _recorder.begin_frame(get_frame_slot());
+        get_current_frame()._frameDescriptors.clear_pools(vulkanData.device);
+    }
 
-        get_current_frame()._deletionQueue.flush();
-        VK_CHECK(vkResetFences(vulkanData.device, 1, &get_current_frame()._renderFence));
+    // windowed: recreate before the acquire, so this frame already renders at the new size
+    if (_swapchainDirty && !vulkanData.headless)
+    {
+        StatsZoneScopedN(_frameStats, "Recreate Swapchain");
+        resize_swapchain();
     }
 
+    // render only the part of the draw image the swapchain shows, scaled down by dynamic resolution.
+    // the background dispatch and the blit's source rect follow drawExtent, the blit scales it up
+    const VkExtent2D &swapchainExtent = p_swapchain->getDataRef().swapchainExtent;
+    VkExtent2D fullExtent = {std::min(swapchainExtent.width, vulkanData.drawImage.imageExtent.width),
+                             std::min(swapchainExtent.height, vulkanData.drawImage.imageExtent.height)};
+    vulkanData.drawExtent = _dynamicResolution.scaled_extent(fullExtent);
+    get_current_frame()._renderScale = _dynamicResolution.scale();
+
+    // changed objects go to this slot's staging memory, the geometry passes copy them
+    _gpuScene.apply_updates(_packet->objectUpdates, _stagingRing);
+    _drawGeometry = _cullPipeline.ready() && _meshPipeline.ready() && _gpuScene.object_count() > 0;
+
+    // async compute: kick off the background pass first so it overlaps the previous frame's graphics work
+    uint64_t computeValue = 0;
+    if (vulkanData.asyncCompute)
     {
-        ZoneScopedN("Aquire Next Image");
-        auto result = vkAcquireNextImageKHR(vulkanData.device, p_swapchain->getDataRef().swapchain, 1000000000, get_current_frame()._swapchainSemaphore, VK_NULL_HANDLE, &swapchainImageIndex);
+        StatsZoneScopedN(_frameStats, "Async Compute");
+        computeValue = submit_async_compute();
+    }
+
+    {
+        StatsZoneScopedN(_frameStats, "Aquire Next Image");
+        if (vulkanData.headless)
+        {
+            // offscreen targets are owned by the frame slot, the timeline wait above already guards them
+            swapchainImageIndex = _frameNumber % p_swapchain->getDataRef().swapchainImages.size();
+        }
+        else
+        {
+            VkResult result = vkAcquireNextImageKHR(vulkanData.device, p_swapchain->getDataRef().swapchain, 1000000000, get_current_frame()._swapchainSemaphore, VK_NULL_HANDLE, &swapchainImageIndex);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR && resize_swapchain())
+            {
+                // the semaphore was not signaled, it can be used again with the new swapchain
+                result = vkAcquireNextImageKHR(vulkanData.device, p_swapchain->getDataRef().swapchain, 1000000000, get_current_frame()._swapchainSemaphore, VK_NULL_HANDLE, &swapchainImageIndex);
+            }
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                // still no image (resized again in between, or minimized): drop the frame.
+                // the async compute work of this slot has to finish before the slot is reused
+                _swapchainDirty = true;
+                if (vulkanData.asyncCompute)
+                {
+                    VK_CHECK(_computeTimeline.wait(computeValue, 1000000000));
+                }
+                return;
+            }
+            if (result == VK_SUBOPTIMAL_KHR)
+            {
+                // the image is acquired and still presentable, recreate after this frame
+                _swapchainDirty = true;
+            }
+            else
+            {
+                VK_CHECK(result);
+            }
+        }
     }
 
     //  wait until the gpu has finished rendering the last frame. Timeout of 1
@@ -716,8 +1803,11 @@ void VulkanRenderer::draw()
 
     auto cmdPool = get_current_frame()._commandPool;
 
+    // submit the uploads requested since the last frame, this frame picks them up
+    _uploads.flush();
+
     {
-        ZoneScopedN("Reset Command Pool");
+        StatsZoneScopedN(_frameStats, "Reset Command Pool");
         VK_CHECK(vkResetCommandPool(vulkanData.device, cmdPool, 0));
     }
     auto cmd = get_current_frame()._mainCommandBuffer;
@@ -729,35 +1819,24 @@ void VulkanRenderer::draw()
     // begin the command buffer recording. We will use this command buffer exactly once, so we want to let vulkan know that
     VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
+    // upload timeline value the frame depends on, 0 = none
+    uint64_t uploadValue = 0;
     {
-        ZoneScopedN("Command Buffer");
-        vulkanData.drawExtent.width = vulkanData.drawImage.imageExtent.width;
-        vulkanData.drawExtent.height = vulkanData.drawImage.imageExtent.height;
+        StatsZoneScopedN(_frameStats, "Command Buffer");
 
         VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
 
-        // transition our main draw image into general layout so we can write into it
-        // we will overwrite it all so we dont care about what was the older layout
-        vkutil::transition_image(cmd, vulkanData.drawImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        _gpuProfiler.begin_frame(cmd, get_frame_slot());
 
-        draw_background(cmd);
+        // one heap bind per command buffer instead of a set per draw
+        _bindless.bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+        _bindless.bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS);
 
-        // transition the draw image and the swapchain image into their correct transfer layouts
-        vkutil::transition_image(cmd, vulkanData.drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-        vkutil::transition_image(cmd, p_swapchain->getDataRef().swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        uploadValue = _uploads.record_acquires(cmd);
 
-        	// execute a copy from the draw image into the swapchain
-	vkutil::copy_image_to_image(cmd, vulkanData.drawImage.image,  p_swapchain->getDataRef().swapchainImages[swapchainImageIndex], 
-    vulkanData.drawExtent, p_swapchain->getDataRef().swapchainExtent);
+        record_frame_graph(cmd, swapchainImageIndex);
 
-	// set swapchain image layout to Attachment Optimal so we can draw it
-	vkutil::transition_image(cmd, p_swapchain->getDataRef().swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-	//draw imgui into the swapchain image
-	draw_imgui(cmd,   p_swapchain->getDataRef().swapchainImageViews[swapchainImageIndex]);
-
-	// set swapchain image layout to Present so we can draw it
-	vkutil::transition_image(cmd, p_swapchain->getDataRef().swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	_gpuProfiler.end_frame(cmd);
 
 	//finalize the command buffer (we can no longer add commands, but it can now be executed)
 	VK_CHECK(vkEndCommandBuffer(cmd));
@@ -809,16 +1888,46 @@ void VulkanRenderer::draw()
 
     VkCommandBufferSubmitInfo cmdinfo = vkinit::command_buffer_submit_info(cmd);
 
-    VkSemaphoreSubmitInfo waitInfo = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, get_current_frame()._swapchainSemaphore);
-    VkSemaphoreSubmitInfo signalInfo = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, get_current_frame()._renderSemaphore);
-
-    VkSubmitInfo2 submit = vkinit::submit_info(&cmdinfo, &signalInfo, &waitInfo);
+    // swapchain image acquire (windowed), the async compute background pass and pending uploads
+    VkSemaphoreSubmitInfo waitInfos[3] = {};
+    uint32_t waitCount = 0;
+    if (!vulkanData.headless)
+    {
+        waitInfos[waitCount++] = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, get_current_frame()._swapchainSemaphore);
+    }
+    if (vulkanData.asyncCompute)
+    {
+        VkPipelineStageFlags2 waitStage = _drawGeometry ? VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_2_BLIT_BIT;
+        waitInfos[waitCount++] = _computeTimeline.wait_info(computeValue, waitStage);
+    }
+    if (uploadValue != 0)
+    {
+        waitInfos[waitCount++] = _uploads.timeline().wait_info(uploadValue, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+    }
+    VkSemaphoreSubmitInfo signalInfos[2] = {
+        vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, get_current_frame()._renderSemaphore),
+        {}};
 
     // submit command buffer to the queue and execute it.
-    //  _renderFence will now block until the graphic commands finish execution
+    //  the frame's timeline value will be reached once the graphic commands finish execution
     {
-        ZoneScopedN("Submit");
-        VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, get_current_frame()._renderFence));
+        StatsZoneScopedN(_frameStats, "Submit");
+        uint64_t frameValue = _timeline.next_value();
+        // host writes into the ring have to be flushed before the submit
+        _stagingRing.end_frame(frameValue);
+        signalInfos[1] = _timeline.signal_info(frameValue, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+        // headless frames have no acquire / present to synchronize with, only the timeline
+        VkSubmitInfo2 submit = vulkanData.headless ? vkinit::submit_info(&cmdinfo, std::span(signalInfos + 1, 1), std::span(waitInfos, waitCount))
+                                                   : vkinit::submit_info(&cmdinfo, std::span(signalInfos, 2), std::span(waitInfos, waitCount));
+        VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, VK_NULL_HANDLE));
+
+        get_current_frame()._timelineValue = frameValue;
+        // the next compute pass writing this draw image has to wait for the blit
+        _drawImageLastUse = frameValue;
+        // objects released while recording this frame retire with it
+        _frameDeletionQueue.assign_pending(frameValue);
+        _bindless.assign_pending(frameValue);
     }
 
     // prepare present
@@ -837,9 +1946,18 @@ void VulkanRenderer::draw()
     presentInfo.pImageIndices = &swapchainImageIndex;
 
     // Present after Write
+    if (!vulkanData.headless)
     {
-        ZoneScopedN("Present");
-        VK_CHECK(vkQueuePresentKHR(_graphicsQueue, &presentInfo));
+        StatsZoneScopedN(_frameStats, "Present");
+        VkResult result = vkQueuePresentKHR(_graphicsQueue, &presentInfo);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+        {
+            _swapchainDirty = true;
+        }
+        else
+        {
+            VK_CHECK(result);
+        }
     }
 
     // increase the number of frames drawn
@@ -852,6 +1970,83 @@ void VulkanRenderer::draw()
     // VK_CHECK(vkAcquireNextImageKHR(_device, swapchain.swapchain, 1000000000, get_current_frame()._swapchainSemaphore,  VK_NULL_HANDLE, &swapchainImageIndex));
 }
 
+void VulkanRenderer::init_profiler()
+{
+    ZoneScoped;
+    GpuProfiler::InitInfo profilerInfo{};
+    profilerInfo.instance = vulkanData.instance;
+    profilerInfo.physicalDevice = vulkanData.chosenGPU;
+    profilerInfo.device = vulkanData.device;
+    profilerInfo.queue = _graphicsQueue;
+    // tracy records its setup commands into the (resettable) immediate command buffer
+    profilerInfo.setupCommandBuffer = _immCommandBuffer;
+    // sized for the largest setting, a few query pools are cheaper than a rebuild
+    profilerInfo.frameSlots = MAX_FRAMES_IN_FLIGHT;
+    profilerInfo.timestampPeriod = _timestampPeriod;
+    profilerInfo.timestampValidBits = _timestampValidBits;
+    profilerInfo.calibratedTimestamps = _calibratedTimestamps;
+    _gpuProfiler.init(profilerInfo);
+
+    if (vulkanData.asyncCompute)
+    {
+        // separate tracy context for the compute queue, set up with a compute family command buffer
+        profilerInfo.queue = _computeQueue;
+        profilerInfo.setupCommandBuffer = _frames[0]._computeCommandBuffer;
+        profilerInfo.timestampValidBits = _computeTimestampValidBits;
+        _computeProfiler.init(profilerInfo);
+    }
+}
+
+void VulkanRenderer::collect_frame_timestamps(uint32_t frameSlot)
+{
+    // only called once the frame's fence has signaled, so the results are available without waiting.
+    // the graphics frame waited on the slot's async compute work, so that is done as well
+    bool graphicsCollected = _gpuProfiler.collect(frameSlot);
+    bool computeCollected = _computeProfiler.collect(frameSlot);
+    if (graphicsCollected)
+    {
+        // async compute runs next to the graphics work, the slower queue is what the budget has to cover
+        double gpuMs = _gpuProfiler.last_frame_ms();
+        if (computeCollected)
+        {
+            gpuMs = std::max(gpuMs, _computeProfiler.last_frame_ms());
+        }
+        _dynamicResolution.update(gpuMs, _frames[frameSlot]._renderScale);
+    }
+    if (!_frameStats.isRecording())
+    {
+        return;
+    }
+    if (graphicsCollected)
+    {
+        _frameStats.addGpuSample(_gpuProfiler.last_frame_ms());
+        // from input sampling until the frame's last command finished on the gpu. the present queue
+        // and scanout come on top, core vulkan has no timestamp for those
+        if (_gpuProfiler.calibrated() && !_gpuProfiler.last_results().empty())
+        {
+            std::chrono::duration<double, std::milli> latency = _gpuProfiler.last_results().front().cpuEnd - _frames[frameSlot]._cpuBeginTime;
+            _frameStats.addSample("latency input to gpu end", latency.count());
+        }
+        for (const auto &timing : _gpuProfiler.last_results())
+        {
+            if (timing.depth > 0)
+            {
+                _frameStats.addSample(std::string("gpu ") + timing.name, timing.ms);
+            }
+        }
+    }
+    if (computeCollected)
+    {
+        for (const auto &timing : _computeProfiler.last_results())
+        {
+            if (timing.depth > 0)
+            {
+                _frameStats.addSample(std::string("gpu compute ") + timing.name, timing.ms);
+            }
+        }
+    }
+}
+
 void VulkanRenderer::init_descriptors()
 {
     // create a descriptor pool that will hold 10 sets with 1 image each
@@ -859,33 +2054,23 @@ void VulkanRenderer::init_descriptors()
         {
             {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}};
 
-    globalDescriptorAllocator.init_pool(vulkanData.device, 10, sizes);
+    globalDescriptorAllocator.init(vulkanData.device, 10, sizes);
+    // the per-frame allocators belong to the frame slots, see init_frames()
+}
 
-    // make the descriptor set layout for our compute draw
+void VulkanRenderer::init_bindless()
+{
+    ZoneScoped;
+    BindlessHeap::InitInfo info{};
+    info.device = vulkanData.device;
+    info.physicalDevice = vulkanData.chosenGPU;
+    info.objectCache = &_objectCache;
+    _bindless.init(info);
+
+    // the draw images live as long as the renderer, their slots are never removed
+    _drawImageIndex = _bindless.add_storage_image(vulkanData.drawImage.imageView);
+    if (vulkanData.asyncCompute)
     {
-        DescriptorLayoutBuilder builder;
-        builder.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        _drawImageDescriptorLayout = builder.build(vulkanData.device, VK_SHADER_STAGE_COMPUTE_BIT);
-        vulkanData.mainDeletionQueue.push_function([&]()
-                                                   { vkDestroyDescriptorSetLayout(vulkanData.device, _drawImageDescriptorLayout, AllocatorCallback::p_allocatorCallback); });
+        _drawImageAltIndex = _bindless.add_storage_image(vulkanData.drawImageAlt.imageView);
     }
-
-    // allocate a descriptor set for our draw image
-    _drawImageDescriptors = globalDescriptorAllocator.allocate(vulkanData.device, _drawImageDescriptorLayout);
-
-    VkDescriptorImageInfo imgInfo{};
-    imgInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    imgInfo.imageView = vulkanData.drawImage.imageView;
-
-    VkWriteDescriptorSet drawImageWrite = {};
-    drawImageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    drawImageWrite.pNext = nullptr;
-
-    drawImageWrite.dstBinding = 0;
-    drawImageWrite.dstSet = _drawImageDescriptors;
-    drawImageWrite.descriptorCount = 1;
-    drawImageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    drawImageWrite.pImageInfo = &imgInfo;
-
-    vkUpdateDescriptorSets(vulkanData.device, 1, &drawImageWrite, 0, nullptr);
 }
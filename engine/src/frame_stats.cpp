@@ -0,0 +1,149 @@
+#include "engine/frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+#include "spdlog/spdlog.h"
+
+void FrameStats::enable(uint32_t warmupFrames)
+{
+    m_enabled = true;
+    m_warmupFrames = warmupFrames;
+}
+
+void FrameStats::beginFrame()
+{
+    m_frameStart = std::chrono::steady_clock::now();
+}
+
+void FrameStats::endFrame()
+{
+    if (isRecording())
+    {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_frameStart;
+        m_cpuFrameMs.push_back(elapsed.count());
+    }
+    m_frameCount++;
+}
+
+std::vector<double> &FrameStats::findSeries(std::vector<Series> &series, const char *name)
+{
+    for (auto &s : series)
+    {
+        if (s.first == name)
+        {
+            return s.second;
+        }
+    }
+    series.emplace_back(name, std::vector<double>{});
+    return series.back().second;
+}
+
+void FrameStats::addZoneSample(const char *name, double ms)
+{
+    if (!isRecording())
+    {
+        return;
+    }
+    findSeries(m_zoneMs, name).push_back(ms);
+}
+
+void FrameStats::addGpuSample(double ms)
+{
+    if (!isRecording())
+    {
+        return;
+    }
+    m_gpuFrameMs.push_back(ms);
+}
+
+void FrameStats::addSample(const std::string &series, double ms)
+{
+    if (!isRecording())
+    {
+        return;
+    }
+    findSeries(m_extraMs, series.c_str()).push_back(ms);
+}
+
+void FrameStats::reset()
+{
+    m_frameCount = 0;
+    m_cpuFrameMs.clear();
+    m_gpuFrameMs.clear();
+    m_zoneMs.clear();
+    m_extraMs.clear();
+}
+
+FrameStats::Summary FrameStats::summarize(std::vector<double> samples)
+{
+    Summary summary{};
+    if (samples.empty())
+    {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    // nearest-rank percentile
+    auto percentile = [&](double p)
+    {
+        size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+
+    summary.count = samples.size();
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.p50 = percentile(50.0);
+    summary.p95 = percentile(95.0);
+    summary.p99 = percentile(99.0);
+    summary.max = samples.back();
+    return summary;
+}
+
+static void writeSummary(std::ofstream &out, const FrameStats::Summary &summary)
+{
+    out << "{\"count\": " << summary.count
+        << ", \"mean\": " << summary.mean
+        << ", \"p50\": " << summary.p50
+        << ", \"p95\": " << summary.p95
+        << ", \"p99\": " << summary.p99
+        << ", \"max\": " << summary.max << "}";
+}
+
+bool FrameStats::writeJson(const std::string &path, const std::string &label) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open())
+    {
+        spdlog::error("FrameStats: could not open {} for writing", path);
+        return false;
+    }
+
+    out << "{\n";
+    out << "  \"label\": \"" << label << "\",\n";
+    out << "  \"frames\": " << m_cpuFrameMs.size() << ",\n";
+    out << "  \"warmup_frames\": " << m_warmupFrames << ",\n";
+    out << "  \"cpu_frame_ms\": ";
+    writeSummary(out, summarize(m_cpuFrameMs));
+    out << ",\n  \"gpu_frame_ms\": ";
+    writeSummary(out, summarize(m_gpuFrameMs));
+
+    auto writeGroup = [&](const char *name, const std::vector<Series> &group)
+    {
+        out << ",\n  \"" << name << "\": {";
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            out << (i == 0 ? "\n" : ",\n") << "    \"" << group[i].first << "\": ";
+            writeSummary(out, summarize(group[i].second));
+        }
+        out << (group.empty() ? "}" : "\n  }");
+    };
+    writeGroup("zones_ms", m_zoneMs);
+    writeGroup("series_ms", m_extraMs);
+    out << "\n}\n";
+
+    spdlog::info("FrameStats: wrote {} frames to {}", m_cpuFrameMs.size(), path);
+    return out.good();
+}
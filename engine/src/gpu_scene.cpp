@@ -0,0 +1,178 @@
+#include "gpu_scene.h"
+#include "vk_initializers.h"
+
+#include <algorithm>
+
+void GpuScene::init(const InitInfo &info)
+{
+    ZoneScoped;
+    m_allocator = info.allocator;
+    m_bindless = info.bindless;
+    m_uploads = info.uploads;
+    m_maxObjects = info.maxObjects;
+    m_maxMeshes = info.maxMeshes;
+    m_maxVertices = info.maxVertices;
+    m_maxIndices = info.maxIndices;
+
+    // everything is filled by copies and read (or written) by shaders through the heap or an address
+    const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    const VkBufferUsageFlags addressable = storage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    // add_mesh() appends while frames draw the earlier meshes. an exclusive buffer would need every
+    // upload to acquire it from the graphics family first, shared between both families it needs nothing
+    std::span<const uint32_t> families = m_uploads->shared_families();
+    m_vertices = vkutil::create_buffer(m_allocator, sizeof(Vertex) * m_maxVertices, addressable, VMA_MEMORY_USAGE_GPU_ONLY, families);
+    m_indices = vkutil::create_buffer(m_allocator, sizeof(uint32_t) * m_maxIndices, storage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                      VMA_MEMORY_USAGE_GPU_ONLY, families);
+    m_meshes = vkutil::create_buffer(m_allocator, sizeof(GpuMesh) * m_maxMeshes, storage, VMA_MEMORY_USAGE_GPU_ONLY, families);
+    m_objects = vkutil::create_buffer(m_allocator, sizeof(GpuObject) * m_maxObjects, addressable, VMA_MEMORY_USAGE_GPU_ONLY);
+    // worst case every object is visible
+    m_draws = vkutil::create_buffer(m_allocator, sizeof(VkDrawIndexedIndirectCommand) * m_maxObjects,
+                                    storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    m_drawCount = vkutil::create_buffer(m_allocator, sizeof(uint32_t), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+    VkBufferDeviceAddressInfo addressInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+    addressInfo.buffer = m_vertices.buffer;
+    m_verticesAddress = vkGetBufferDeviceAddress(info.device, &addressInfo);
+    addressInfo.buffer = m_objects.buffer;
+    m_objectsAddress = vkGetBufferDeviceAddress(info.device, &addressInfo);
+
+    m_meshesIndex = m_bindless->add_storage_buffer(m_meshes.buffer);
+    m_objectsIndex = m_bindless->add_storage_buffer(m_objects.buffer);
+    m_drawsIndex = m_bindless->add_storage_buffer(m_draws.buffer);
+    m_drawCountIndex = m_bindless->add_storage_buffer(m_drawCount.buffer);
+
+    spdlog::info("GpuScene: {} objects, {} meshes, {} vertices, {} indices", m_maxObjects, m_maxMeshes, m_maxVertices, m_maxIndices);
+}
+
+void GpuScene::destroy()
+{
+    // the heap goes away with the renderer, only the buffers are ours
+    for (AllocatedBuffer *buffer : {&m_vertices, &m_indices, &m_meshes, &m_objects, &m_draws, &m_drawCount})
+    {
+        if (buffer->buffer != VK_NULL_HANDLE)
+        {
+            vkutil::destroy_buffer(m_allocator, *buffer);
+            *buffer = {};
+        }
+    }
+}
+
+uint32_t GpuScene::add_mesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+    ZoneScoped;
+    if (vertices.empty() || indices.empty())
+    {
+        return INVALID_MESH;
+    }
+
+    GpuMesh mesh{};
+    // bounding sphere around the center of the box, good enough for culling
+    glm::vec3 minimum = vertices[0].position;
+    glm::vec3 maximum = vertices[0].position;
+    for (const Vertex &vertex : vertices)
+    {
+        minimum = glm::min(minimum, vertex.position);
+        maximum = glm::max(maximum, vertex.position);
+    }
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    float radius = 0.0f;
+    for (const Vertex &vertex : vertices)
+    {
+        radius = std::max(radius, glm::length(vertex.position - center));
+    }
+    mesh.bounds = glm::vec4(center, radius);
+    mesh.indexCount = (uint32_t)indices.size();
+
+    uint32_t meshIndex;
+    {
+        std::lock_guard lock(m_meshMutex);
+        if (m_meshCount == m_maxMeshes || m_vertexCount + vertices.size() > m_maxVertices || m_indexCount + indices.size() > m_maxIndices)
+        {
+            spdlog::error("GpuScene: no room for a mesh of {} vertices / {} indices", vertices.size(), indices.size());
+            return INVALID_MESH;
+        }
+        meshIndex = m_meshCount++;
+        mesh.vertexOffset = (int32_t)m_vertexCount;
+        mesh.firstIndex = m_indexCount;
+        m_vertexCount += (uint32_t)vertices.size();
+        m_indexCount += (uint32_t)indices.size();
+    }
+
+    // the ranges are reserved, the copies do not need the lock
+    m_uploads->upload_buffer(m_vertices.buffer, mesh.vertexOffset * sizeof(Vertex), vertices.data(), vertices.size_bytes(), true);
+    m_uploads->upload_buffer(m_indices.buffer, mesh.firstIndex * sizeof(uint32_t), indices.data(), indices.size_bytes(), true);
+    m_uploads->upload_buffer(m_meshes.buffer, meshIndex * sizeof(GpuMesh), &mesh, sizeof(GpuMesh), true);
+    return meshIndex;
+}
+
+void GpuScene::apply_updates(std::span<const ObjectUpdate> updates, StagingRing &ring)
+{
+    ZoneScoped;
+    // a dropped frame never recorded its copies, its updates go out with this frame's
+    if (m_copies.empty())
+    {
+        m_pending.clear();
+    }
+    m_copies.clear();
+    m_pending.insert(m_pending.end(), updates.begin(), updates.end());
+    if (m_pending.empty())
+    {
+        return;
+    }
+
+    // sorted by object, the last update of an object wins and neighbours go out as one copy
+    std::stable_sort(m_pending.begin(), m_pending.end(), [](const ObjectUpdate &lhs, const ObjectUpdate &rhs)
+                     { return lhs.object < rhs.object; });
+    size_t unique = 0;
+    for (size_t i = 0; i < m_pending.size(); i++)
+    {
+        if (m_pending[i].object >= m_maxObjects)
+        {
+            spdlog::error("GpuScene: object {} is past the capacity of {}", m_pending[i].object, m_maxObjects);
+            continue;
+        }
+        if (unique > 0 && m_pending[unique - 1].object == m_pending[i].object)
+        {
+            m_pending[unique - 1] = m_pending[i];
+        }
+        else
+        {
+            m_pending[unique++] = m_pending[i];
+        }
+    }
+    m_pending.resize(unique);
+
+    for (size_t begin = 0; begin < m_pending.size();)
+    {
+        size_t end = begin + 1;
+        while (end < m_pending.size() && m_pending[end].object == m_pending[end - 1].object + 1)
+        {
+            end++;
+        }
+
+        StagingRing::Allocation staging = ring.allocate(sizeof(GpuObject) * (end - begin), alignof(GpuObject));
+        GpuObject *objects = (GpuObject *)staging.mapped;
+        for (size_t i = begin; i < end; i++)
+        {
+            objects[i - begin] = {.model = m_pending[i].model, .mesh = m_pending[i].mesh};
+        }
+
+        VkBufferCopy region{};
+        region.srcOffset = staging.offset;
+        region.dstOffset = m_pending[begin].object * sizeof(GpuObject);
+        region.size = sizeof(GpuObject) * (end - begin);
+        m_copies.push_back({staging.buffer, region});
+
+        m_objectCount = std::max(m_objectCount, m_pending[end - 1].object + 1);
+        begin = end;
+    }
+}
+
+void GpuScene::record_object_copies(VkCommandBuffer cmd)
+{
+    for (const ObjectCopy &copy : m_copies)
+    {
+        vkCmdCopyBuffer(cmd, copy.source, m_objects.buffer, 1, &copy.region);
+    }
+    m_copies.clear();
+}
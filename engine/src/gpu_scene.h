@@ -0,0 +1,157 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "vk_bindless.h"
+#include "vk_staging_ring.h"
+#include "vk_upload.h"
+
+#include <mutex>
+
+#include <glm/vec3.hpp>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+// vertex layout the mesh shader pulls through the vertex buffer's address, scalar / std430 compatible
+struct Vertex
+{
+    glm::vec3 position;
+    float uv_x;
+    glm::vec3 normal;
+    float uv_y;
+    glm::vec4 color;
+};
+
+// one registered mesh, read by the cull shader
+struct GpuMesh
+{
+    // bounding sphere in mesh space: xyz center, w radius
+    glm::vec4 bounds;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t padding;
+};
+
+// one drawable instance, read by the cull and the mesh shaders
+struct GpuObject
+{
+    glm::mat4 model;
+    // GpuScene::INVALID_MESH = free slot, never drawn
+    uint32_t mesh;
+    uint32_t padding[3];
+};
+
+// change of one object, handed from the simulation to the render thread in the render packet
+struct ObjectUpdate
+{
+    uint32_t object;
+    uint32_t mesh;
+    glm::mat4 model;
+};
+
+// a scene entity drawn by the GpuScene, see VulkanRenderer::addMeshInstance()
+struct MeshInstance
+{
+    uint32_t mesh;
+    uint32_t object;
+};
+
+// Scene data for GPU driven rendering.
+// Meshes share one vertex and one index buffer, their draw ranges and bounds sit in a mesh table.
+// Objects live in a fixed capacity storage buffer, only changed objects are copied per frame.
+// A compute pass culls every object against the frustum and appends VkDrawIndexedIndirectCommands
+// (firstInstance = object index) plus a count, one vkCmdDrawIndexedIndirectCount draws them all.
+// So the cpu cost per frame follows the number of changes, not the number of objects.
+// The cull shader reaches the buffers through the bindless heap, the vertex shader through buffer
+// device addresses. both get them in push constants.
+class GpuScene
+{
+public:
+    static constexpr uint32_t INVALID_MESH = ~0u;
+
+    struct InitInfo
+    {
+        VkDevice device;
+        VmaAllocator allocator;
+        BindlessHeap *bindless;
+        // mesh data goes through the regular uploads
+        UploadContext *uploads;
+        uint32_t maxObjects{65536};
+        uint32_t maxMeshes{1024};
+        uint32_t maxVertices{1024 * 1024};
+        uint32_t maxIndices{4 * 1024 * 1024};
+    };
+
+    void init(const InitInfo &info);
+    void destroy();
+
+    // thread safe. returns INVALID_MESH when a buffer is full. objects may use the mesh in every
+    // frame recorded after the uploads' next flush()
+    uint32_t add_mesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+
+    // render thread, after the staging ring's begin_frame(): stages the changes for record_object_copies().
+    // changes staged for a frame that was dropped before recording are staged again
+    void apply_updates(std::span<const ObjectUpdate> updates, StagingRing &ring);
+    bool has_object_copies() const { return !m_copies.empty(); }
+    void record_object_copies(VkCommandBuffer cmd);
+
+    // highest object index + 1, the cull dispatch and the max draw count
+    uint32_t object_count() const { return m_objectCount; }
+    uint32_t max_objects() const { return m_maxObjects; }
+
+    const AllocatedBuffer &objects() const { return m_objects; }
+    const AllocatedBuffer &draws() const { return m_draws; }
+    const AllocatedBuffer &draw_count() const { return m_drawCount; }
+    const AllocatedBuffer &indices() const { return m_indices; }
+
+    // read by the vertex shader through buffer device addresses
+    VkDeviceAddress vertices_address() const { return m_verticesAddress; }
+    VkDeviceAddress objects_address() const { return m_objectsAddress; }
+
+    // bindless storage buffer indices, read by the cull shader
+    uint32_t meshes_index() const { return m_meshesIndex; }
+    uint32_t objects_index() const { return m_objectsIndex; }
+    uint32_t draws_index() const { return m_drawsIndex; }
+    uint32_t draw_count_index() const { return m_drawCountIndex; }
+
+private:
+    struct ObjectCopy
+    {
+        VkBuffer source;
+        VkBufferCopy region;
+    };
+
+    VmaAllocator m_allocator{VK_NULL_HANDLE};
+    BindlessHeap *m_bindless{nullptr};
+    UploadContext *m_uploads{nullptr};
+
+    AllocatedBuffer m_vertices{};
+    AllocatedBuffer m_indices{};
+    AllocatedBuffer m_meshes{};
+    AllocatedBuffer m_objects{};
+    AllocatedBuffer m_draws{};
+    AllocatedBuffer m_drawCount{};
+    VkDeviceAddress m_verticesAddress{0};
+    VkDeviceAddress m_objectsAddress{0};
+    uint32_t m_meshesIndex{BindlessHeap::INVALID_INDEX};
+    uint32_t m_objectsIndex{BindlessHeap::INVALID_INDEX};
+    uint32_t m_drawsIndex{BindlessHeap::INVALID_INDEX};
+    uint32_t m_drawCountIndex{BindlessHeap::INVALID_INDEX};
+
+    uint32_t m_maxObjects{0};
+    uint32_t m_maxMeshes{0};
+    uint32_t m_maxVertices{0};
+    uint32_t m_maxIndices{0};
+
+    // add_mesh() may run on any thread
+    std::mutex m_meshMutex;
+    uint32_t m_meshCount{0};
+    uint32_t m_vertexCount{0};
+    uint32_t m_indexCount{0};
+
+    // render thread. m_pending holds the updates behind m_copies until they are recorded
+    uint32_t m_objectCount{0};
+    std::vector<ObjectUpdate> m_pending;
+    std::vector<ObjectCopy> m_copies;
+};
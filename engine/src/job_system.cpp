@@ -0,0 +1,288 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    thread_local uint32_t t_workerIndex = JobSystem::NOT_A_WORKER;
+}
+
+uint32_t JobSystem::worker_index() { return t_workerIndex; }
+
+void JobSystem::init(uint32_t threadCount, uint32_t externalThreads)
+{
+    ZoneScoped;
+    externalThreads = std::max(externalThreads, 1u);
+    if (threadCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > externalThreads ? hardwareThreads - externalThreads : 0;
+    }
+
+    m_workers.clear();
+    for (uint32_t i = 0; i < externalThreads + threadCount; i++)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    m_externalInUse.assign(externalThreads, false);
+    m_externalInUse[0] = true;
+    t_workerIndex = 0;
+
+    m_stop = false;
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        m_threads.emplace_back([this, worker = externalThreads + i]
+                               { worker_loop(worker); });
+    }
+    spdlog::info("JobSystem: {} worker threads, {} external threads", threadCount, externalThreads);
+}
+
+void JobSystem::destroy()
+{
+    // nothing scheduled gets lost, whatever is left runs here
+    while (m_queued.load() > 0 && t_workerIndex != NOT_A_WORKER)
+    {
+        run_one(t_workerIndex);
+    }
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &thread : m_threads)
+    {
+        thread.join();
+    }
+    m_threads.clear();
+    m_workers.clear();
+    m_externalInUse.clear();
+    t_workerIndex = NOT_A_WORKER;
+}
+
+bool JobSystem::attach_thread()
+{
+    if (t_workerIndex != NOT_A_WORKER)
+    {
+        return true;
+    }
+    std::lock_guard lock(m_externalMutex);
+    for (uint32_t i = 0; i < m_externalInUse.size(); i++)
+    {
+        if (!m_externalInUse[i])
+        {
+            m_externalInUse[i] = true;
+            t_workerIndex = i;
+            return true;
+        }
+    }
+    spdlog::error("JobSystem: no free external slot, the thread cannot run jobs");
+    return false;
+}
+
+void JobSystem::detach_thread()
+{
+    if (t_workerIndex == NOT_A_WORKER || t_workerIndex >= m_externalInUse.size())
+    {
+        return;
+    }
+    std::lock_guard lock(m_externalMutex);
+    m_externalInUse[t_workerIndex] = false;
+    t_workerIndex = NOT_A_WORKER;
+}
+
+void JobSystem::schedule(const char *name, Job &&job, Counter *counter)
+{
+    if (counter)
+    {
+        counter->m_pending.fetch_add(1);
+    }
+    push({std::move(job), name, counter});
+}
+
+void JobSystem::schedule_after(Counter &dependency, const char *name, Job &&job, Counter *counter)
+{
+    if (counter)
+    {
+        counter->m_pending.fetch_add(1);
+    }
+    {
+        std::lock_guard lock(dependency.m_mutex);
+        if (dependency.m_pending.load() > 0)
+        {
+            // queued by the job that finishes the dependency
+            dependency.m_continuations.push_back({std::move(job), name, counter});
+            return;
+        }
+    }
+    push({std::move(job), name, counter});
+}
+
+void JobSystem::parallel_for(const char *name, uint32_t count, uint32_t grain, const RangeJob &job)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (grain == 0)
+    {
+        // a few ranges per worker, so a worker that got slow ranges is balanced by stealing
+        grain = std::max(1u, count / (worker_count() * 4));
+    }
+    if (count <= grain)
+    {
+        job(0, count);
+        return;
+    }
+
+    Counter counter;
+    for (uint32_t begin = 0; begin < count; begin += grain)
+    {
+        uint32_t end = std::min(begin + grain, count);
+        schedule(name, [&job, begin, end]
+                 { job(begin, end); }, &counter);
+    }
+    wait(counter);
+}
+
+void JobSystem::wait(Counter &counter)
+{
+    ZoneScoped;
+    uint32_t worker = worker_index();
+    while (!counter.done())
+    {
+        if (worker != NOT_A_WORKER && run_one(worker))
+        {
+            continue;
+        }
+        std::unique_lock lock(m_sleepMutex);
+        m_sleeping++;
+        m_wake.wait(lock, [&]
+                    { return counter.done() || (worker != NOT_A_WORKER && m_queued.load() > 0); });
+        m_sleeping--;
+    }
+    // the job that finished the counter may still hold its mutex, the counter must outlive that
+    std::lock_guard lock(counter.m_mutex);
+}
+
+void JobSystem::push(Task &&task)
+{
+    // counted before it is visible, so a thief never takes the count below zero
+    m_queued.fetch_add(1);
+    uint32_t worker = worker_index();
+    // other threads hand their jobs to worker 0, anyone may steal them from there
+    Worker &target = *m_workers[worker == NOT_A_WORKER ? 0 : worker];
+    {
+        std::lock_guard lock(target.mutex);
+        target.tasks.push_back(std::move(task));
+    }
+    wake();
+}
+
+bool JobSystem::run_one(uint32_t worker)
+{
+    Task task;
+    bool found = false;
+    {
+        // own jobs newest first
+        Worker &own = *m_workers[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+    // steal the oldest job of the next worker that has one, they tend to be the larger ones
+    uint32_t count = worker_count();
+    for (uint32_t i = 1; i < count && !found; i++)
+    {
+        Worker &victim = *m_workers[(worker + i) % count];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        return false;
+    }
+    m_queued.fetch_sub(1);
+    run(task);
+    return true;
+}
+
+void JobSystem::run(Task &task)
+{
+    ZoneScopedN("Job");
+    if (task.name)
+    {
+        ZoneName(task.name, strlen(task.name));
+    }
+    task.job();
+    finish(task.counter);
+}
+
+void JobSystem::finish(Counter *counter)
+{
+    if (!counter)
+    {
+        return;
+    }
+    std::vector<Task> continuations;
+    {
+        std::lock_guard lock(counter->m_mutex);
+        if (counter->m_pending.fetch_sub(1) != 1)
+        {
+            return;
+        }
+        continuations.swap(counter->m_continuations);
+    }
+    for (auto &task : continuations)
+    {
+        push(std::move(task));
+    }
+    // waiters sleep on the same condition variable as idle workers
+    wake();
+}
+
+void JobSystem::wake()
+{
+    if (m_sleeping.load() > 0)
+    {
+        // taking the lock orders this after a sleeper's predicate check, so the notification cannot fall between
+        // that check and its wait
+        {
+            std::lock_guard lock(m_sleepMutex);
+        }
+        m_wake.notify_all();
+    }
+}
+
+void JobSystem::worker_loop(uint32_t worker)
+{
+    t_workerIndex = worker;
+    std::string threadName = fmt::format("Job Worker {}", worker);
+    tracy::SetThreadName(threadName.c_str());
+    while (true)
+    {
+        if (run_one(worker))
+        {
+            continue;
+        }
+        std::unique_lock lock(m_sleepMutex);
+        m_sleeping++;
+        m_wake.wait(lock, [this]
+                    { return m_stop || m_queued.load() > 0; });
+        m_sleeping--;
+        if (m_stop)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Work stealing job scheduler.
+// Every worker owns a deque: it pushes and pops its own jobs at the back (newest first, still warm in
+// cache) and steals from the front of the others when it runs dry. Dedicated workers are threads of
+// their own. Long lived threads of the caller (the one that called init() is worker 0, the render
+// thread attaches itself) get a deque as well and run jobs while they wait on a counter.
+// Dependencies are continuation style: a job scheduled after a counter is queued once the counter
+// reaches zero instead of blocking a worker.
+// Threads that are not workers may schedule and wait, but never run jobs, so worker_index() stays
+// unique among the threads executing jobs and can index per worker resources.
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+    class Counter;
+
+private:
+    struct Task
+    {
+        Job job;
+        const char *name{nullptr};
+        Counter *counter{nullptr};
+    };
+
+public:
+    // [begin, end) range of a parallel_for
+    using RangeJob = std::function<void(uint32_t begin, uint32_t end)>;
+
+    // number of unfinished jobs that were scheduled with it
+    class Counter
+    {
+    public:
+        Counter() = default;
+        Counter(const Counter &) = delete;
+        Counter &operator=(const Counter &) = delete;
+
+        bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> m_pending{0};
+        // jobs waiting for m_pending to reach zero
+        std::mutex m_mutex;
+        std::vector<Task> m_continuations;
+    };
+
+    static constexpr uint32_t NOT_A_WORKER = ~0u;
+
+    // threadCount dedicated workers, 0 = one per hardware thread not taken by an external thread.
+    // externalThreads deques are reserved for attach_thread(), the calling thread takes the first
+    void init(uint32_t threadCount, uint32_t externalThreads = 1);
+    // runs what is still queued and joins the workers
+    void destroy();
+
+    // makes the calling thread a worker on a free external slot, false when every slot is taken
+    bool attach_thread();
+    // frees the calling thread's external slot, its queued jobs stay stealable
+    void detach_thread();
+
+    // name shows up as the job's tracy zone and has to outlive the job
+    void schedule(const char *name, Job &&job, Counter *counter = nullptr);
+    // job is queued once dependency reached zero
+    void schedule_after(Counter &dependency, const char *name, Job &&job, Counter *counter = nullptr);
+    // splits [0, count) into ranges of grain (0 = a few per worker) and blocks until all ran
+    void parallel_for(const char *name, uint32_t count, uint32_t grain, const RangeJob &job);
+
+    // blocks until counter reached zero, workers run other jobs meanwhile.
+    // a counter on the stack may only go out of scope after this returned
+    void wait(Counter &counter);
+
+    // dedicated and external workers
+    uint32_t worker_count() const { return (uint32_t)m_workers.size(); }
+    // worker running on this thread, NOT_A_WORKER for other threads
+    static uint32_t worker_index();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task &&task);
+    // own jobs first, then steals, false when every deque was empty
+    bool run_one(uint32_t worker);
+    void run(Task &task);
+    void finish(Counter *counter);
+    // wakes sleeping workers and waiters if there are any
+    void wake();
+    void worker_loop(uint32_t worker);
+
+    // unique_ptr: workers are not movable
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    // external slots handed out by attach_thread()
+    std::mutex m_externalMutex;
+    std::vector<bool> m_externalInUse;
+
+    // sleeping workers and waiters, woken by new jobs and finished counters
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<uint32_t> m_queued{0};
+    std::atomic<uint32_t> m_sleeping{0};
+    bool m_stop{false};
+};
@@ -0,0 +1,46 @@
+#include "render_packet.h"
+
+UiDrawSnapshot::~UiDrawSnapshot()
+{
+    for (ImDrawList *list : m_lists)
+    {
+        IM_DELETE(list);
+    }
+}
+
+void UiDrawSnapshot::capture(const ImDrawData *source)
+{
+    ZoneScoped;
+    m_valid = source != nullptr && source->Valid;
+    if (!m_valid)
+    {
+        return;
+    }
+
+    // only what the renderer backend reads, the lists are not used to build anything
+    m_data.Valid = true;
+    m_data.CmdListsCount = source->CmdListsCount;
+    m_data.TotalIdxCount = source->TotalIdxCount;
+    m_data.TotalVtxCount = source->TotalVtxCount;
+    m_data.DisplayPos = source->DisplayPos;
+    m_data.DisplaySize = source->DisplaySize;
+    m_data.FramebufferScale = source->FramebufferScale;
+    m_data.OwnerViewport = nullptr;
+
+    while (m_lists.Size < source->CmdListsCount)
+    {
+        m_lists.push_back(IM_NEW(ImDrawList)(nullptr));
+    }
+    m_data.CmdLists.resize(source->CmdListsCount);
+    for (int i = 0; i < source->CmdListsCount; i++)
+    {
+        const ImDrawList *list = source->CmdLists[i];
+        ImDrawList *copy = m_lists[i];
+        // ImVector assignment copies into the existing allocation when it is large enough
+        copy->CmdBuffer = list->CmdBuffer;
+        copy->IdxBuffer = list->IdxBuffer;
+        copy->VtxBuffer = list->VtxBuffer;
+        copy->Flags = list->Flags;
+        m_data.CmdLists[i] = copy;
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+#include "imgui.h"
+
+// Copy of imgui's draw data that stays valid while the next imgui frame is built.
+// The draw lists are owned by the snapshot and reuse their buffers from capture to capture.
+class UiDrawSnapshot
+{
+public:
+    UiDrawSnapshot() = default;
+    UiDrawSnapshot(const UiDrawSnapshot &) = delete;
+    UiDrawSnapshot &operator=(const UiDrawSnapshot &) = delete;
+    ~UiDrawSnapshot();
+
+    // call after ImGui::Render(), on the thread building the imgui frame
+    void capture(const ImDrawData *source);
+    // nullptr when nothing was captured
+    ImDrawData *draw_data() { return m_valid ? &m_data : nullptr; }
+
+private:
+    ImDrawData m_data;
+    ImVector<ImDrawList *> m_lists;
+    bool m_valid{false};
+};
+
+// Bounded queue of reused packets between one producer and one consumer thread.
+// The producer fills a free packet and submits it, the consumer takes them in submission order.
+// The producer only blocks once depth packets wait for the consumer, the consumer only while the
+// queue is empty.
+template <typename Packet>
+class PacketQueue
+{
+public:
+    // depth queued packets, plus the one being written and the one being read
+    void init(uint32_t depth)
+    {
+        std::lock_guard lock(m_mutex);
+        m_depth = std::max(depth, 1u);
+        m_packets.clear();
+        m_free.clear();
+        m_queued.clear();
+        for (uint32_t i = 0; i < m_depth + 2; i++)
+        {
+            m_packets.push_back(std::make_unique<Packet>());
+            m_free.push_back(m_packets.back().get());
+        }
+        m_closed = false;
+    }
+
+    // free packet to fill, nullptr once the queue is closed
+    Packet *begin_write()
+    {
+        std::unique_lock lock(m_mutex);
+        m_changed.wait(lock, [this]
+                       { return m_closed || m_queued.size() < m_depth; });
+        if (m_closed)
+        {
+            return nullptr;
+        }
+        Packet *packet = m_free.back();
+        m_free.pop_back();
+        return packet;
+    }
+    void submit(Packet *packet)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_queued.push_back(packet);
+        }
+        m_changed.notify_all();
+    }
+
+    // oldest submitted packet, nullptr once the queue is closed and drained
+    Packet *begin_read()
+    {
+        std::unique_lock lock(m_mutex);
+        m_changed.wait(lock, [this]
+                       { return m_closed || !m_queued.empty(); });
+        if (m_queued.empty())
+        {
+            return nullptr;
+        }
+        Packet *packet = m_queued.front();
+        m_queued.pop_front();
+        return packet;
+    }
+    void end_read(Packet *packet)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_free.push_back(packet);
+        }
+        m_changed.notify_all();
+    }
+
+    // wakes both sides, the consumer still gets the packets submitted before
+    void close()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_closed = true;
+        }
+        m_changed.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    uint32_t m_depth{1};
+    bool m_closed{false};
+    std::vector<std::unique_ptr<Packet>> m_packets;
+    std::vector<Packet *> m_free;
+    std::deque<Packet *> m_queued;
+};
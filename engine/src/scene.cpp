@@ -0,0 +1,212 @@
+#include "scene.h"
+
+#include <algorithm>
+
+namespace
+{
+    // entities per job below which splitting a level costs more than it saves
+    constexpr uint32_t MIN_ENTITIES_PER_JOB = 1024;
+
+    // translation * rotation * scale without the three matrix products
+    glm::mat4 local_matrix(const Transform &transform)
+    {
+        glm::mat4 matrix = glm::mat4_cast(transform.rotation);
+        matrix[0] *= transform.scale.x;
+        matrix[1] *= transform.scale.y;
+        matrix[2] *= transform.scale.z;
+        matrix[3] = glm::vec4(transform.position, 1.0f);
+        return matrix;
+    }
+}
+
+entt::entity Scene::create(const Transform &transform, entt::entity parent)
+{
+    entt::entity entity = m_registry.create();
+    m_registry.emplace<Transform>(entity, transform);
+    m_registry.emplace<WorldTransform>(entity);
+    m_registry.emplace<Hierarchy>(entity).parent = parent;
+    m_orderDirty = true;
+    return entity;
+}
+
+void Scene::destroy(entt::entity entity)
+{
+    ZoneScoped;
+    if (m_orderDirty)
+    {
+        rebuild_order();
+    }
+
+    // children come after their parents in the sorted order, so one pass from the entity on finds every descendant
+    auto &hierarchies = m_registry.storage<Hierarchy>();
+    auto hierarchy = hierarchies.begin();
+    uint32_t first = m_orderOf[entt::to_entity(entity)];
+    std::vector<uint8_t> doomed(hierarchies.size() - first, 0);
+    std::vector<entt::entity> entities;
+    auto view = m_registry.view<Hierarchy>();
+    auto entityIt = view.begin() + first;
+    for (uint32_t k = first; k < hierarchies.size(); k++, ++entityIt)
+    {
+        uint32_t parentIndex = hierarchy[k].parentIndex;
+        if (k == first || (parentIndex != ~0u && parentIndex >= first && doomed[parentIndex - first]))
+        {
+            doomed[k - first] = 1;
+            entities.push_back(*entityIt);
+        }
+    }
+    m_registry.destroy(entities.begin(), entities.end());
+    m_orderDirty = true;
+}
+
+bool Scene::set_parent(entt::entity entity, entt::entity parent)
+{
+    // no cycles: the new parent must not be the entity or one of its descendants
+    for (entt::entity ancestor = parent; ancestor != entt::null; ancestor = m_registry.get<Hierarchy>(ancestor).parent)
+    {
+        if (ancestor == entity)
+        {
+            spdlog::warn("Scene: refusing to parent an entity to itself or one of its descendants");
+            return false;
+        }
+    }
+    m_registry.get<Hierarchy>(entity).parent = parent;
+    m_orderDirty = true;
+    return true;
+}
+
+void Scene::set_local(entt::entity entity, const Transform &transform)
+{
+    m_registry.get<Transform>(entity) = transform;
+    // a pending rebuild recomputes everything anyway
+    if (!m_orderDirty)
+    {
+        m_dirty[m_orderOf[entt::to_entity(entity)]] = 1;
+        m_anyDirty = true;
+    }
+}
+
+void Scene::mark_all_dirty()
+{
+    std::fill(m_dirty.begin(), m_dirty.end(), 1);
+    m_anyDirty = !m_dirty.empty();
+}
+
+void Scene::update(JobSystem &jobs)
+{
+    ZoneScoped;
+    if (m_orderDirty)
+    {
+        rebuild_order();
+    }
+    m_updated = m_anyDirty;
+    if (!m_anyDirty)
+    {
+        return;
+    }
+
+    // a level only reads the world matrices of the one before, its entities are independent
+    for (size_t level = 0; level + 1 < m_levels.size(); level++)
+    {
+        uint32_t begin = m_levels[level];
+        uint32_t count = m_levels[level + 1] - begin;
+        uint32_t grain = std::max(MIN_ENTITIES_PER_JOB, count / (jobs.worker_count() * 4));
+        jobs.parallel_for("Scene Transforms", count, grain, [this, begin](uint32_t first, uint32_t last)
+                          { update_range(begin + first, begin + last); });
+    }
+    m_anyDirty = false;
+}
+
+void Scene::update_range(uint32_t begin, uint32_t end)
+{
+    // the three storages share the depth sorted order, k indexes all of them
+    auto hierarchy = m_registry.storage<Hierarchy>().begin();
+    auto local = m_registry.storage<Transform>().begin();
+    auto world = m_registry.storage<WorldTransform>().begin();
+    for (uint32_t k = begin; k < end; k++)
+    {
+        const Hierarchy &node = hierarchy[k];
+        bool hasParent = node.parentIndex != ~0u;
+        if (!m_dirty[k] && !(hasParent && m_changed[node.parentIndex]))
+        {
+            m_changed[k] = 0;
+            continue;
+        }
+        m_dirty[k] = 0;
+        m_changed[k] = 1;
+        glm::mat4 matrix = local_matrix(local[k]);
+        world[k].matrix = hasParent ? world[node.parentIndex].matrix * matrix : matrix;
+    }
+}
+
+uint32_t Scene::compute_depth(entt::entity entity)
+{
+    // walk up to the first ancestor with a final depth (or past the root), then assign on the way down
+    m_path.clear();
+    uint32_t depth = 0;
+    for (entt::entity current = entity; current != entt::null; current = m_registry.get<Hierarchy>(current).parent)
+    {
+        if (m_depthStamp[entt::to_entity(current)] == m_depthPass)
+        {
+            depth = m_registry.get<Hierarchy>(current).depth + 1;
+            break;
+        }
+        m_path.push_back(current);
+    }
+    for (size_t i = m_path.size(); i-- > 0;)
+    {
+        m_registry.get<Hierarchy>(m_path[i]).depth = depth++;
+        m_depthStamp[entt::to_entity(m_path[i])] = m_depthPass;
+    }
+    return m_registry.get<Hierarchy>(entity).depth;
+}
+
+void Scene::rebuild_order()
+{
+    ZoneScoped;
+    auto view = m_registry.view<Hierarchy>();
+    uint32_t maxIndex = 0;
+    for (entt::entity entity : view)
+    {
+        maxIndex = std::max(maxIndex, (uint32_t)entt::to_entity(entity));
+    }
+    m_depthStamp.resize(maxIndex + 1, 0);
+    m_orderOf.resize(maxIndex + 1);
+
+    m_depthPass++;
+    for (entt::entity entity : view)
+    {
+        compute_depth(entity);
+    }
+
+    // parents before children, the other two storages follow
+    m_registry.sort<Hierarchy>([](const Hierarchy &lhs, const Hierarchy &rhs)
+                               { return lhs.depth < rhs.depth; });
+    m_registry.sort<Transform, Hierarchy>();
+    m_registry.sort<WorldTransform, Hierarchy>();
+
+    m_levels.clear();
+    uint32_t k = 0;
+    uint32_t levelDepth = ~0u;
+    for (auto [entity, node] : view.each())
+    {
+        m_orderOf[entt::to_entity(entity)] = k;
+        if (node.depth != levelDepth)
+        {
+            m_levels.push_back(k);
+            levelDepth = node.depth;
+        }
+        k++;
+    }
+    m_levels.push_back(k);
+    for (auto [entity, node] : view.each())
+    {
+        node.parentIndex = node.parent == entt::null ? ~0u : m_orderOf[entt::to_entity(node.parent)];
+    }
+
+    // the packed order changed, every world matrix is recomputed once
+    m_dirty.assign(k, 1);
+    m_changed.assign(k, 0);
+    m_orderDirty = false;
+    m_anyDirty = k > 0;
+    spdlog::debug("Scene: sorted {} entities into {} depth levels", k, depth_levels());
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "job_system.h"
+
+#include <entt/entt.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// local transform, relative to the parent
+struct Transform
+{
+    glm::vec3 position{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+};
+
+// parent * local, written by Scene::update()
+struct WorldTransform
+{
+    glm::mat4 matrix{1.0f};
+};
+
+struct Hierarchy
+{
+    entt::entity parent{entt::null};
+    // roots are 0
+    uint32_t depth{0};
+    // position of the parent in the sorted storages, valid after Scene::update()
+    uint32_t parentIndex{~0u};
+};
+
+// Scene graph on an entt::registry.
+// Every scene entity has a Transform, a WorldTransform and a Hierarchy. The three storages are kept
+// sorted by depth, parents before their children, so the world matrices are computed in one linear
+// pass per depth level, every level split across the job system's workers. Only entities whose
+// transform changed (and their descendants) recompute.
+// Transform, WorldTransform and Hierarchy are only added through create(), the sorted positions
+// assume every scene entity has all three.
+// Not thread safe: create, modify and update from one thread, the one calling run() in the engine.
+class Scene
+{
+public:
+    entt::entity create(const Transform &transform = {}, entt::entity parent = entt::null);
+    // destroys the entity and everything below it
+    void destroy(entt::entity entity);
+    bool valid(entt::entity entity) const { return m_registry.valid(entity); }
+
+    // entt::null makes the entity a root. refused (false) when parent is the entity or below it
+    bool set_parent(entt::entity entity, entt::entity parent);
+    entt::entity parent(entt::entity entity) const { return m_registry.get<Hierarchy>(entity).parent; }
+
+    const Transform &local(entt::entity entity) const { return m_registry.get<Transform>(entity); }
+    // marks the entity's subtree for the next update()
+    void set_local(entt::entity entity, const Transform &transform);
+    // world matrix as of the last update()
+    const glm::mat4 &world(entt::entity entity) const { return m_registry.get<WorldTransform>(entity).matrix; }
+
+    // recomputes the world matrices of every changed subtree
+    void update(JobSystem &jobs);
+    // everything recomputes on the next update(), for benchmarks
+    void mark_all_dirty();
+    // calls function(entity, world matrix) for every entity whose world matrix the last update() recomputed
+    template <typename Function>
+    void each_changed(Function &&function)
+    {
+        if (!m_updated || m_orderDirty)
+        {
+            return;
+        }
+        auto world = m_registry.storage<WorldTransform>().begin();
+        auto entity = m_registry.view<Hierarchy>().begin();
+        for (size_t k = 0; k < m_changed.size(); k++, ++entity)
+        {
+            if (m_changed[k])
+            {
+                function(*entity, world[k].matrix);
+            }
+        }
+    }
+
+    size_t size() { return m_registry.storage<Hierarchy>().size(); }
+    uint32_t depth_levels() const { return m_levels.empty() ? 0 : (uint32_t)m_levels.size() - 1; }
+    // other components go next to the scene ones
+    entt::registry &registry() { return m_registry; }
+
+private:
+    // depth of every entity, depth sorted storages, parent indices and level ranges
+    void rebuild_order();
+    uint32_t compute_depth(entt::entity entity);
+    void update_range(uint32_t begin, uint32_t end);
+
+    entt::registry m_registry;
+
+    // sorted position of every entity (by entity index), valid while !m_orderDirty
+    std::vector<uint32_t> m_orderOf;
+    // per sorted position: set by set_local(), cleared by update()
+    std::vector<uint8_t> m_dirty;
+    // per sorted position: the world matrix was recomputed this update, read by the children's level
+    std::vector<uint8_t> m_changed;
+    // sorted position where each depth level starts, plus the end
+    std::vector<uint32_t> m_levels;
+    // entities created, destroyed or reparented since the last sort
+    bool m_orderDirty{false};
+    bool m_anyDirty{false};
+    // the last update() recomputed something, m_changed is valid
+    bool m_updated{false};
+    // rebuild_order() bookkeeping, the depth of an entity stamped with the current pass is final
+    std::vector<uint32_t> m_depthStamp;
+    uint32_t m_depthPass{0};
+    std::vector<entt::entity> m_path;
+};
@@ -0,0 +1,122 @@
+#include "vk_barriers.h"
+#include "vk_initializers.h"
+
+void BarrierBatcher::image(VkImage image, ImageState &state, VkImageLayout newLayout, VkPipelineStageFlags2 stage, VkAccessFlags2 access,
+                           bool discard, VkImageAspectFlags aspect)
+{
+    const bool write = (access & kWriteAccessMask) != 0;
+    const bool pendingWrite = (state.access & kWriteAccessMask) != 0;
+    const bool acquire = !discard && state.queueFamily != VK_QUEUE_FAMILY_IGNORED && state.queueFamily != m_queueFamily;
+
+    if (!discard && !acquire && state.layout == newLayout && state.stage == VK_PIPELINE_STAGE_2_NONE)
+    {
+        // nothing happened to the image that this use would have to wait for
+        m_skipped++;
+        state.stage = stage;
+        state.access = write ? (access & kWriteAccessMask) : access;
+        return;
+    }
+
+    if (!discard && !acquire && !write && !pendingWrite && state.layout == newLayout)
+    {
+        if ((stage & ~state.stage) == 0 && (access & ~state.access) == 0)
+        {
+            // an earlier barrier already made the last write visible to this use
+            m_skipped++;
+            return;
+        }
+        // another reader: chaining onto the earlier readers is enough, the write is already available
+        VkImageMemoryBarrier2 &barrier = m_imageBarriers.emplace_back(VkImageMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2});
+        barrier.srcStageMask = state.stage;
+        barrier.srcAccessMask = VK_ACCESS_2_NONE;
+        barrier.dstStageMask = stage;
+        barrier.dstAccessMask = access;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = vkinit::image_subresource_range(aspect);
+        state.stage |= stage;
+        state.access |= access;
+        return;
+    }
+
+    VkImageMemoryBarrier2 &barrier = m_imageBarriers.emplace_back(VkImageMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2});
+    // an acquire chains onto the semaphore wait of its submission, the release flushed the writes
+    barrier.srcStageMask = acquire ? stage : state.stage;
+    barrier.srcAccessMask = acquire ? VK_ACCESS_2_NONE : (state.access & kWriteAccessMask);
+    barrier.dstStageMask = stage;
+    barrier.dstAccessMask = access;
+    barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = acquire ? state.queueFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = acquire ? m_queueFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = vkinit::image_subresource_range(aspect);
+
+    state.layout = newLayout;
+    state.stage = stage;
+    state.access = write ? (access & kWriteAccessMask) : access;
+    state.queueFamily = VK_QUEUE_FAMILY_IGNORED;
+}
+
+void BarrierBatcher::image(AllocatedImage &image, VkImageLayout newLayout, VkPipelineStageFlags2 stage, VkAccessFlags2 access, bool discard)
+{
+    VkImageAspectFlags aspect = image.imageFormat == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    this->image(image.image, image.state, newLayout, stage, access, discard, aspect);
+}
+
+void BarrierBatcher::release(VkImage image, ImageState &state, VkImageLayout newLayout, uint32_t dstQueueFamily, VkImageAspectFlags aspect)
+{
+    VkImageMemoryBarrier2 &barrier = m_imageBarriers.emplace_back(VkImageMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2});
+    barrier.srcStageMask = state.stage;
+    barrier.srcAccessMask = state.access & kWriteAccessMask;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+    barrier.dstAccessMask = VK_ACCESS_2_NONE;
+    barrier.oldLayout = state.layout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = m_queueFamily;
+    barrier.dstQueueFamilyIndex = dstQueueFamily;
+    barrier.image = image;
+    barrier.subresourceRange = vkinit::image_subresource_range(aspect);
+
+    // the acquire has to repeat the release's layouts, so the state keeps the old one
+    state.stage = VK_PIPELINE_STAGE_2_NONE;
+    state.access = VK_ACCESS_2_NONE;
+    state.queueFamily = m_queueFamily;
+}
+
+void BarrierBatcher::buffer(VkBuffer buffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage,
+                            VkAccessFlags2 dstAccess, uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+    VkBufferMemoryBarrier2 &barrier = m_bufferBarriers.emplace_back(VkBufferMemoryBarrier2{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2});
+    barrier.srcStageMask = srcStage;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstStageMask = dstStage;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = srcQueueFamily;
+    barrier.dstQueueFamilyIndex = dstQueueFamily;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+}
+
+bool BarrierBatcher::flush(VkCommandBuffer cmd)
+{
+    if (empty())
+    {
+        return false;
+    }
+
+    VkDependencyInfo depInfo = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    depInfo.imageMemoryBarrierCount = (uint32_t)m_imageBarriers.size();
+    depInfo.pImageMemoryBarriers = m_imageBarriers.data();
+    depInfo.bufferMemoryBarrierCount = (uint32_t)m_bufferBarriers.size();
+    depInfo.pBufferMemoryBarriers = m_bufferBarriers.data();
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    m_imageBarriers.clear();
+    m_bufferBarriers.clear();
+    return true;
+}
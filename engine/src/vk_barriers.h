@@ -0,0 +1,50 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+// every access flag that writes memory
+constexpr VkAccessFlags2 kWriteAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+                                            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                            VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+// Collects image / buffer barriers and records them as one vkCmdPipelineBarrier2 on flush().
+// Image barriers are derived from the tracked ImageState: the old layout and source scope come
+// from the last use, and transitions that would not change anything are dropped.
+// Call flush() right before the command that needs the barriers.
+class BarrierBatcher
+{
+public:
+    // queue family the barriers are recorded for, images released by another family get acquired
+    explicit BarrierBatcher(uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED) : m_queueFamily(queueFamily) {}
+    void set_queue_family(uint32_t queueFamily) { m_queueFamily = queueFamily; }
+
+    // makes the image ready for a use at stage / access in newLayout. skipped when it already is in
+    // newLayout and the use only reads what earlier barriers made visible.
+    // discard: old contents are not needed, the transition starts from UNDEFINED and skips the acquire
+    void image(VkImage image, ImageState &state, VkImageLayout newLayout, VkPipelineStageFlags2 stage, VkAccessFlags2 access,
+               bool discard = false, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+    void image(AllocatedImage &image, VkImageLayout newLayout, VkPipelineStageFlags2 stage, VkAccessFlags2 access, bool discard = false);
+    // release half of an ownership transfer. the acquiring family calls image() with the same newLayout
+    void release(VkImage image, ImageState &state, VkImageLayout newLayout, uint32_t dstQueueFamily,
+                 VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+
+    void buffer(VkBuffer buffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess,
+                uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+    // barriers computed elsewhere (render graph)
+    void add(const VkImageMemoryBarrier2 &barrier) { m_imageBarriers.push_back(barrier); }
+    void add(const VkBufferMemoryBarrier2 &barrier) { m_bufferBarriers.push_back(barrier); }
+
+    // records everything queued so far as one dependency, returns false when there was nothing to record
+    bool flush(VkCommandBuffer cmd);
+    bool empty() const { return m_imageBarriers.empty() && m_bufferBarriers.empty(); }
+
+    // transitions image() dropped as redundant, since construction
+    uint32_t skipped() const { return m_skipped; }
+
+private:
+    uint32_t m_queueFamily;
+    std::vector<VkImageMemoryBarrier2> m_imageBarriers;
+    std::vector<VkBufferMemoryBarrier2> m_bufferBarriers;
+    uint32_t m_skipped{0};
+};
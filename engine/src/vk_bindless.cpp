@@ -0,0 +1,241 @@
+#include "vk_bindless.h"
+
+#include <algorithm>
+
+static constexpr VkDescriptorType kBindingTypes[BindlessHeap::BindingCount] = {
+    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    VK_DESCRIPTOR_TYPE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+};
+
+static constexpr const char *kBindingNames[BindlessHeap::BindingCount] = {
+    "sampled images",
+    "storage images",
+    "samplers",
+    "storage buffers",
+};
+
+uint32_t BindlessHeap::IndexAllocator::allocate()
+{
+    if (!freeList.empty())
+    {
+        uint32_t index = freeList.back();
+        freeList.pop_back();
+        return index;
+    }
+    if (next < capacity)
+    {
+        return next++;
+    }
+    return INVALID_INDEX;
+}
+
+void BindlessHeap::init(const InitInfo &info)
+{
+    ZoneScoped;
+    m_device = info.device;
+
+    VkPhysicalDeviceVulkan12Properties properties12 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES};
+    VkPhysicalDeviceProperties2 properties = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    properties.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(info.physicalDevice, &properties);
+
+    uint32_t counts[BindingCount] = {
+        std::min({info.sampledImages, properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages}),
+        std::min({info.storageImages, properties12.maxDescriptorSetUpdateAfterBindStorageImages, properties12.maxPerStageDescriptorUpdateAfterBindStorageImages}),
+        std::min({info.samplers, properties12.maxDescriptorSetUpdateAfterBindSamplers, properties12.maxPerStageDescriptorUpdateAfterBindSamplers}),
+        std::min({info.storageBuffers, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers}),
+    };
+
+    // all arrays are visible to every stage, so together they also have to fit the per-stage resource limit
+    uint64_t total = uint64_t(counts[0]) + counts[1] + counts[2] + counts[3];
+    if (total > properties12.maxPerStageUpdateAfterBindResources)
+    {
+        double scale = double(properties12.maxPerStageUpdateAfterBindResources) / double(total);
+        for (auto &count : counts)
+        {
+            count = std::max(1u, uint32_t(count * scale));
+        }
+    }
+
+    VkDescriptorSetLayoutBinding bindings[BindingCount] = {};
+    VkDescriptorBindingFlags bindingFlags[BindingCount] = {};
+    VkDescriptorPoolSize poolSizes[BindingCount] = {};
+    for (uint32_t i = 0; i < BindingCount; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = kBindingTypes[i];
+        bindings[i].descriptorCount = counts[i];
+        bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+
+        // unused slots may stay empty, written slots can change while other slots are in use by the gpu
+        bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        poolSizes[i] = {kBindingTypes[i], counts[i]};
+        m_indices[i].capacity = counts[i];
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO};
+    bindingFlagsInfo.bindingCount = BindingCount;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = BindingCount;
+    layoutInfo.pBindings = bindings;
+    m_layout = info.objectCache->get_descriptor_set_layout(layoutInfo);
+
+    VkDescriptorPoolCreateInfo poolInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = BindingCount;
+    poolInfo.pPoolSizes = poolSizes;
+    VK_CHECK(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool));
+
+    VkDescriptorSetAllocateInfo allocInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocInfo.descriptorPool = m_pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_layout;
+    VK_CHECK(vkAllocateDescriptorSets(m_device, &allocInfo, &m_set));
+
+    VkPushConstantRange pushConstants{};
+    pushConstants.stageFlags = VK_SHADER_STAGE_ALL;
+    pushConstants.offset = 0;
+    pushConstants.size = info.pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_layout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstants;
+    m_pipelineLayout = info.objectCache->get_pipeline_layout(pipelineLayoutInfo);
+
+    spdlog::info("BindlessHeap: {} {}, {} {}, {} {}, {} {}", counts[0], kBindingNames[0], counts[1], kBindingNames[1],
+                 counts[2], kBindingNames[2], counts[3], kBindingNames[3]);
+}
+
+void BindlessHeap::destroy()
+{
+    // the layouts belong to the object cache
+    vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_pool = VK_NULL_HANDLE;
+    m_layout = VK_NULL_HANDLE;
+    m_set = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessHeap::add(Binding binding, const VkDescriptorImageInfo *imageInfo, const VkDescriptorBufferInfo *bufferInfo)
+{
+    std::lock_guard lock(m_mutex);
+    uint32_t index = m_indices[binding].allocate();
+    if (index == INVALID_INDEX)
+    {
+        spdlog::error("BindlessHeap: out of {} ({})", kBindingNames[binding], m_indices[binding].capacity);
+        return INVALID_INDEX;
+    }
+
+    VkWriteDescriptorSet write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet = m_set;
+    write.dstBinding = binding;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = kBindingTypes[binding];
+    write.pImageInfo = imageInfo;
+    write.pBufferInfo = bufferInfo;
+
+    // fine while the set is bound: the slot was not in use (update after bind + unused while pending)
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    return index;
+}
+
+uint32_t BindlessHeap::add_sampled_image(VkImageView view, VkImageLayout layout)
+{
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = layout;
+    return add(SampledImages, &imageInfo, nullptr);
+}
+
+uint32_t BindlessHeap::add_storage_image(VkImageView view)
+{
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    return add(StorageImages, &imageInfo, nullptr);
+}
+
+uint32_t BindlessHeap::add_sampler(VkSampler sampler)
+{
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = sampler;
+    return add(Samplers, &imageInfo, nullptr);
+}
+
+uint32_t BindlessHeap::add_storage_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+    return add(StorageBuffers, nullptr, &bufferInfo);
+}
+
+void BindlessHeap::remove(Binding binding, uint32_t index, uint64_t retireValue)
+{
+    if (index == INVALID_INDEX)
+    {
+        return;
+    }
+    std::lock_guard lock(m_mutex);
+    m_pendingFrees.push_back({binding, index, retireValue});
+    if (retireValue == RETIRE_PENDING)
+    {
+        m_untagged++;
+    }
+}
+
+void BindlessHeap::assign_pending(uint64_t retireValue)
+{
+    std::lock_guard lock(m_mutex);
+    // untagged frees are mostly the newest ones, walk back until all of them are tagged
+    for (auto it = m_pendingFrees.rbegin(); it != m_pendingFrees.rend() && m_untagged > 0; it++)
+    {
+        if (it->retireValue == RETIRE_PENDING)
+        {
+            it->retireValue = retireValue;
+            m_untagged--;
+        }
+    }
+}
+
+void BindlessHeap::collect(uint64_t completedValue)
+{
+    std::lock_guard lock(m_mutex);
+    size_t kept = 0;
+    for (size_t i = 0; i < m_pendingFrees.size(); i++)
+    {
+        const PendingFree &pending = m_pendingFrees[i];
+        if (pending.retireValue <= completedValue)
+        {
+            if (pending.retireValue == RETIRE_PENDING)
+            {
+                m_untagged--;
+            }
+            // the stale descriptor stays in the slot until it is reused, partially bound allows that
+            m_indices[pending.binding].free(pending.index);
+        }
+        else
+        {
+            m_pendingFrees[kept++] = pending;
+        }
+    }
+    m_pendingFrees.resize(kept);
+}
+
+void BindlessHeap::bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const
+{
+    vkCmdBindDescriptorSets(cmd, bindPoint, m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "vk_object_cache.h"
+
+#include <mutex>
+
+// Global bindless descriptor heap.
+// One descriptor set with large UPDATE_AFTER_BIND / PARTIALLY_BOUND arrays per resource type;
+// resources get an index from a free-list and shaders index the arrays with it
+// (usually through a push constant). The renderer binds the set once per command buffer.
+//
+//  set 0, binding 0: texture2D sampledImages[]
+//  set 0, binding 1: image2D   storageImages[]   (format given in the shader)
+//  set 0, binding 2: sampler   samplers[]
+//  set 0, binding 3: buffer    storageBuffers[]
+class BindlessHeap
+{
+public:
+    enum Binding : uint32_t
+    {
+        SampledImages = 0,
+        StorageImages = 1,
+        Samplers = 2,
+        StorageBuffers = 3,
+        BindingCount = 4
+    };
+
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+    // same meaning as in DeletionQueue: the index is freed with the frame that is being recorded
+    static constexpr uint64_t RETIRE_PENDING = ~0ull - 1;
+
+    struct InitInfo
+    {
+        VkDevice device;
+        VkPhysicalDevice physicalDevice;
+        // owns the set layout and the shared pipeline layout
+        VulkanObjectCache *objectCache;
+        // requested array sizes, clamped to the device's update-after-bind limits
+        uint32_t sampledImages{16384};
+        uint32_t storageImages{4096};
+        uint32_t samplers{256};
+        uint32_t storageBuffers{16384};
+        // push constant range of the shared pipeline layout, 128 is the guaranteed minimum
+        uint32_t pushConstantSize{128};
+    };
+
+    void init(const InitInfo &info);
+    void destroy();
+
+    uint32_t add_sampled_image(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t add_storage_image(VkImageView view);
+    uint32_t add_sampler(VkSampler sampler);
+    uint32_t add_storage_buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+    // the index is handed out again once the gpu reached retireValue (see assign_pending())
+    void remove(Binding binding, uint32_t index, uint64_t retireValue = RETIRE_PENDING);
+    void assign_pending(uint64_t retireValue);
+    void collect(uint64_t completedValue);
+
+    // binds the heap as set 0 with the shared pipeline layout
+    void bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const;
+
+    VkDescriptorSetLayout layout() const { return m_layout; }
+    // set 0 = the heap, push constants visible to all stages. use it for every bindless pipeline
+    VkPipelineLayout pipeline_layout() const { return m_pipelineLayout; }
+    VkDescriptorSet set() const { return m_set; }
+    uint32_t capacity(Binding binding) const { return m_indices[binding].capacity; }
+
+private:
+    struct IndexAllocator
+    {
+        uint32_t capacity{0};
+        uint32_t next{0};
+        std::vector<uint32_t> freeList;
+
+        uint32_t allocate();
+        void free(uint32_t index) { freeList.push_back(index); }
+    };
+
+    struct PendingFree
+    {
+        Binding binding;
+        uint32_t index;
+        uint64_t retireValue;
+    };
+
+    uint32_t add(Binding binding, const VkDescriptorImageInfo *imageInfo, const VkDescriptorBufferInfo *bufferInfo);
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_layout{VK_NULL_HANDLE};
+    VkDescriptorPool m_pool{VK_NULL_HANDLE};
+    VkDescriptorSet m_set{VK_NULL_HANDLE};
+    VkPipelineLayout m_pipelineLayout{VK_NULL_HANDLE};
+
+    std::mutex m_mutex;
+    IndexAllocator m_indices[BindingCount];
+    std::vector<PendingFree> m_pendingFrees;
+    // RETIRE_PENDING entries in m_pendingFrees, remove() with a known value may come after them
+    size_t m_untagged{0};
+};
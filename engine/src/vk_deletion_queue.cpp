@@ -0,0 +1,191 @@
+#include "engine/vk_deletion_queue.h"
+
+void DeletionQueue::init(VkDevice device, VmaAllocator allocator)
+{
+    m_device = device;
+    m_allocator = allocator;
+}
+
+void DeletionQueue::push_image(VkImage image, VmaAllocation allocation, uint64_t retireValue)
+{
+    push(m_images, ImageAllocation{image, allocation}, retireValue);
+}
+
+void DeletionQueue::push_buffer(VkBuffer buffer, VmaAllocation allocation, uint64_t retireValue)
+{
+    push(m_buffers, BufferAllocation{buffer, allocation}, retireValue);
+}
+
+void DeletionQueue::push_image_view(VkImageView view, uint64_t retireValue)
+{
+    push(m_imageViews, view, retireValue);
+}
+
+void DeletionQueue::push_sampler(VkSampler sampler, uint64_t retireValue)
+{
+    push(m_samplers, sampler, retireValue);
+}
+
+void DeletionQueue::push_pipeline(VkPipeline pipeline, uint64_t retireValue)
+{
+    push(m_pipelines, pipeline, retireValue);
+}
+
+void DeletionQueue::push_pipeline_layout(VkPipelineLayout layout, uint64_t retireValue)
+{
+    push(m_pipelineLayouts, layout, retireValue);
+}
+
+void DeletionQueue::push_descriptor_set_layout(VkDescriptorSetLayout layout, uint64_t retireValue)
+{
+    push(m_descriptorSetLayouts, layout, retireValue);
+}
+
+void DeletionQueue::push_descriptor_pool(VkDescriptorPool pool, uint64_t retireValue)
+{
+    push(m_descriptorPools, pool, retireValue);
+}
+
+void DeletionQueue::push_command_pool(VkCommandPool pool, uint64_t retireValue)
+{
+    push(m_commandPools, pool, retireValue);
+}
+
+void DeletionQueue::push_fence(VkFence fence, uint64_t retireValue)
+{
+    push(m_fences, fence, retireValue);
+}
+
+void DeletionQueue::push_semaphore(VkSemaphore semaphore, uint64_t retireValue)
+{
+    push(m_semaphores, semaphore, retireValue);
+}
+
+void DeletionQueue::push_function(std::function<void()> &&function, uint64_t retireValue)
+{
+    push(m_functions, std::move(function), retireValue);
+}
+
+template <typename T>
+void DeletionQueue::push(List<T> &list, T handle, uint64_t retireValue)
+{
+    list.entries.push_back({std::move(handle), retireValue});
+    if (retireValue == RETIRE_PENDING)
+    {
+        list.pending++;
+    }
+}
+
+template <typename T, typename Destroy>
+void DeletionQueue::retire(List<T> &list, uint64_t completedValue, Destroy &&destroy)
+{
+    auto &entries = list.entries;
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].retireValue <= completedValue)
+        {
+            // only flush() without a value gets here with pending entries
+            if (entries[i].retireValue == RETIRE_PENDING)
+            {
+                list.pending--;
+            }
+            destroy(entries[i].handle);
+        }
+        else
+        {
+            if (kept != i)
+            {
+                entries[kept] = std::move(entries[i]);
+            }
+            kept++;
+        }
+    }
+    entries.erase(entries.begin() + kept, entries.end());
+}
+
+template <typename T>
+void DeletionQueue::assign(List<T> &list, uint64_t retireValue)
+{
+    // pending entries are mostly the most recent ones, but pushes with a known value may sit
+    // between them. walk back until every pending entry is tagged
+    for (auto it = list.entries.rbegin(); it != list.entries.rend() && list.pending > 0; it++)
+    {
+        if (it->retireValue == RETIRE_PENDING)
+        {
+            it->retireValue = retireValue;
+            list.pending--;
+        }
+    }
+}
+
+void DeletionQueue::assign_pending(uint64_t retireValue)
+{
+    assign(m_pipelines, retireValue);
+    assign(m_pipelineLayouts, retireValue);
+    assign(m_descriptorPools, retireValue);
+    assign(m_descriptorSetLayouts, retireValue);
+    assign(m_samplers, retireValue);
+    assign(m_imageViews, retireValue);
+    assign(m_images, retireValue);
+    assign(m_buffers, retireValue);
+    assign(m_commandPools, retireValue);
+    assign(m_fences, retireValue);
+    assign(m_semaphores, retireValue);
+    assign(m_functions, retireValue);
+}
+
+void DeletionQueue::flush(uint64_t completedValue)
+{
+    ZoneScoped;
+
+    // custom teardown first, newest to oldest like the old functor queue
+    if (!m_functions.entries.empty())
+    {
+        for (auto it = m_functions.entries.rbegin(); it != m_functions.entries.rend(); it++)
+        {
+            if (it->retireValue <= completedValue)
+            {
+                it->handle(); // call functors
+            }
+        }
+        retire(m_functions, completedValue, [](std::function<void()> &) {});
+    }
+
+    // users before the objects they reference
+    retire(m_pipelines, completedValue, [&](VkPipeline h)
+           { vkDestroyPipeline(m_device, h, nullptr); });
+    retire(m_pipelineLayouts, completedValue, [&](VkPipelineLayout h)
+           { vkDestroyPipelineLayout(m_device, h, nullptr); });
+    retire(m_descriptorPools, completedValue, [&](VkDescriptorPool h)
+           { vkDestroyDescriptorPool(m_device, h, nullptr); });
+    retire(m_descriptorSetLayouts, completedValue, [&](VkDescriptorSetLayout h)
+           { vkDestroyDescriptorSetLayout(m_device, h, nullptr); });
+    retire(m_samplers, completedValue, [&](VkSampler h)
+           { vkDestroySampler(m_device, h, nullptr); });
+    retire(m_imageViews, completedValue, [&](VkImageView h)
+           { vkDestroyImageView(m_device, h, nullptr); });
+    retire(m_images, completedValue, [&](const ImageAllocation &h)
+           { vmaDestroyImage(m_allocator, h.image, h.allocation); });
+    retire(m_buffers, completedValue, [&](const BufferAllocation &h)
+           { vmaDestroyBuffer(m_allocator, h.buffer, h.allocation); });
+    retire(m_commandPools, completedValue, [&](VkCommandPool h)
+           { vkDestroyCommandPool(m_device, h, nullptr); });
+    retire(m_fences, completedValue, [&](VkFence h)
+           { vkDestroyFence(m_device, h, nullptr); });
+    retire(m_semaphores, completedValue, [&](VkSemaphore h)
+           { vkDestroySemaphore(m_device, h, nullptr); });
+}
+
+void DeletionQueue::flush()
+{
+    flush(~0ull);
+}
+
+size_t DeletionQueue::size() const
+{
+    return m_pipelines.entries.size() + m_pipelineLayouts.entries.size() + m_descriptorPools.entries.size() +
+           m_descriptorSetLayouts.entries.size() + m_samplers.entries.size() + m_imageViews.entries.size() +
+           m_images.entries.size() + m_buffers.entries.size() + m_commandPools.entries.size() +
+           m_fences.entries.size() + m_semaphores.entries.size() + m_functions.entries.size();
+}
@@ -33,7 +33,7 @@ VkCommandBufferBeginInfo vkinit::command_buffer_begin_info(VkCommandBufferUsageF
     return info;
 }
 
-VkSemaphoreSubmitInfo vkinit::semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore)
+VkSemaphoreSubmitInfo vkinit::semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore, uint64_t value /*= 1*/)
 {
 	VkSemaphoreSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
@@ -41,7 +41,7 @@ VkSemaphoreSubmitInfo vkinit::semaphore_submit_info(VkPipelineStageFlags2 stageM
 	submitInfo.semaphore = semaphore;
 	submitInfo.stageMask = stageMask;
 	submitInfo.deviceIndex = 0;
-	submitInfo.value = 1;
+	submitInfo.value = value; // only used by timeline semaphores
 
 	return submitInfo;
 }
@@ -75,6 +75,39 @@ VkRenderingAttachmentInfo vkinit::attachment_info(
     return colorAttachment;
 }
 
+VkRenderingAttachmentInfo vkinit::depth_attachment_info(
+    VkImageView view, VkImageLayout layout /*= VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL*/)
+{
+    VkRenderingAttachmentInfo depthAttachment {};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.pNext = nullptr;
+
+    depthAttachment.imageView = view;
+    depthAttachment.imageLayout = layout;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.clearValue.depthStencil.depth = 0.f;
+
+    return depthAttachment;
+}
+
+VkRenderingInfo vkinit::rendering_info(VkExtent2D renderExtent, VkRenderingAttachmentInfo* colorAttachment,
+    VkRenderingAttachmentInfo* depthAttachment)
+{
+    VkRenderingInfo renderInfo {};
+    renderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderInfo.pNext = nullptr;
+
+    renderInfo.renderArea = VkRect2D { VkOffset2D { 0, 0 }, renderExtent };
+    renderInfo.layerCount = 1;
+    renderInfo.colorAttachmentCount = colorAttachment ? 1 : 0;
+    renderInfo.pColorAttachments = colorAttachment;
+    renderInfo.pDepthAttachment = depthAttachment;
+    renderInfo.pStencilAttachment = nullptr;
+
+    return renderInfo;
+}
+
 
 VkSubmitInfo2 vkinit::submit_info(VkCommandBufferSubmitInfo* cmd, VkSemaphoreSubmitInfo* signalSemaphoreInfo,
     VkSemaphoreSubmitInfo* waitSemaphoreInfo)
@@ -95,6 +128,20 @@ VkSubmitInfo2 vkinit::submit_info(VkCommandBufferSubmitInfo* cmd, VkSemaphoreSub
     return info;
 }
 
+VkSubmitInfo2 vkinit::submit_info(VkCommandBufferSubmitInfo* cmd, std::span<VkSemaphoreSubmitInfo> signalSemaphoreInfos,
+    std::span<VkSemaphoreSubmitInfo> waitSemaphoreInfos)
+{
+    VkSubmitInfo2 info = submit_info(cmd, nullptr, nullptr);
+
+    info.waitSemaphoreInfoCount = (uint32_t)waitSemaphoreInfos.size();
+    info.pWaitSemaphoreInfos = waitSemaphoreInfos.data();
+
+    info.signalSemaphoreInfoCount = (uint32_t)signalSemaphoreInfos.size();
+    info.pSignalSemaphoreInfos = signalSemaphoreInfos.data();
+
+    return info;
+}
+
 
 VkImageSubresourceRange vkinit::image_subresource_range(VkImageAspectFlags aspectMask)
 {
@@ -261,3 +308,83 @@ void vkutil::copy_image_to_image(VkCommandBuffer cmd, VkImage source, VkImage de
 
 	vkCmdBlitImage2(cmd, &blitInfo);
 }
+
+void vkutil::image_barrier(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout,
+						   VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess,
+						   uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+	VkImageMemoryBarrier2 imageBarrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2, .pNext = nullptr };
+
+	imageBarrier.srcStageMask = srcStage;
+	imageBarrier.srcAccessMask = srcAccess;
+	imageBarrier.dstStageMask = dstStage;
+	imageBarrier.dstAccessMask = dstAccess;
+
+	imageBarrier.oldLayout = currentLayout;
+	imageBarrier.newLayout = newLayout;
+
+	// both halves of an ownership transfer have to name the same pair of families
+	imageBarrier.srcQueueFamilyIndex = srcQueueFamily;
+	imageBarrier.dstQueueFamilyIndex = dstQueueFamily;
+
+	VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	imageBarrier.subresourceRange = vkinit::image_subresource_range(aspectMask);
+	imageBarrier.image = image;
+
+	VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .pNext = nullptr };
+	depInfo.imageMemoryBarrierCount = 1;
+	depInfo.pImageMemoryBarriers = &imageBarrier;
+
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+void vkutil::buffer_barrier(VkCommandBuffer cmd, VkBuffer buffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+							VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess, uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+	VkBufferMemoryBarrier2 bufferBarrier{ .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2, .pNext = nullptr };
+
+	bufferBarrier.srcStageMask = srcStage;
+	bufferBarrier.srcAccessMask = srcAccess;
+	bufferBarrier.dstStageMask = dstStage;
+	bufferBarrier.dstAccessMask = dstAccess;
+	bufferBarrier.srcQueueFamilyIndex = srcQueueFamily;
+	bufferBarrier.dstQueueFamilyIndex = dstQueueFamily;
+	bufferBarrier.buffer = buffer;
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+
+	VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .pNext = nullptr };
+	depInfo.bufferMemoryBarrierCount = 1;
+	depInfo.pBufferMemoryBarriers = &bufferBarrier;
+
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+AllocatedBuffer vkutil::create_buffer(VmaAllocator allocator, size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+									  std::span<const uint32_t> queueFamilies)
+{
+	// allocate buffer
+	VkBufferCreateInfo bufferInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferInfo.pNext = nullptr;
+	bufferInfo.size = allocSize;
+	bufferInfo.usage = usage;
+	if (queueFamilies.size() > 1)
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = (uint32_t)queueFamilies.size();
+		bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+	}
+
+	VmaAllocationCreateInfo vmaallocInfo = {};
+	vmaallocInfo.usage = memoryUsage;
+	vmaallocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	AllocatedBuffer newBuffer;
+	VK_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &vmaallocInfo, &newBuffer.buffer, &newBuffer.allocation, &newBuffer.info));
+	return newBuffer;
+}
+
+void vkutil::destroy_buffer(VmaAllocator allocator, const AllocatedBuffer& buffer)
+{
+	vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+}
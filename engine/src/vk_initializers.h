@@ -29,17 +29,22 @@ namespace vkinit
 
 	VkImageSubresourceRange image_subresource_range(VkImageAspectFlags aspectMask);
 
-	VkSemaphoreSubmitInfo semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore);
+	VkSemaphoreSubmitInfo semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore, uint64_t value = 1);
 
 	VkCommandBufferSubmitInfo command_buffer_submit_info(VkCommandBuffer cmd);
 
 	VkSubmitInfo2 submit_info(VkCommandBufferSubmitInfo *cmd, VkSemaphoreSubmitInfo *signalSemaphoreInfo,
 							  VkSemaphoreSubmitInfo *waitSemaphoreInfo);
+	VkSubmitInfo2 submit_info(VkCommandBufferSubmitInfo *cmd, std::span<VkSemaphoreSubmitInfo> signalSemaphoreInfos,
+							  std::span<VkSemaphoreSubmitInfo> waitSemaphoreInfos);
 	VkImageCreateInfo image_create_info(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent);							  
 
 	VkImageViewCreateInfo imageview_create_info(VkFormat format, VkImage image, VkImageAspectFlags aspectFlags);
 
 	VkRenderingAttachmentInfo attachment_info(VkImageView view, VkClearValue* clear ,VkImageLayout layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	// cleared to 0, the far plane of the reverse-z projection
+	VkRenderingAttachmentInfo depth_attachment_info(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+	VkRenderingInfo rendering_info(VkExtent2D renderExtent, VkRenderingAttachmentInfo* colorAttachment, VkRenderingAttachmentInfo* depthAttachment);
 
 }
 
@@ -49,5 +54,18 @@ namespace vkutil
 	void transition_image(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout);
 	void transition_image_to_present(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout);
 	void copy_image_to_image(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D srcSize, VkExtent2D dstSize);
+	// explicit stages / access masks, optionally moving ownership between queue families (release or acquire half)
+	void image_barrier(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout,
+					   VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess,
+					   uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
+	void buffer_barrier(VkCommandBuffer cmd, VkBuffer buffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+						VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess,
+						uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+	// buffers are always created mapped, info.pMappedData is null unless the memory is host visible.
+	// more than one queue family = VK_SHARING_MODE_CONCURRENT between them, no ownership transfers
+	AllocatedBuffer create_buffer(VmaAllocator allocator, size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+								  std::span<const uint32_t> queueFamilies = {});
+	void destroy_buffer(VmaAllocator allocator, const AllocatedBuffer& buffer);
 }
 // vulkan init code goes here
@@ -0,0 +1,270 @@
+#include "vk_object_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+static void push_u64(std::vector<uint32_t> &key, uint64_t value)
+{
+    key.push_back(uint32_t(value));
+    key.push_back(uint32_t(value >> 32));
+}
+
+static void push_handle(std::vector<uint32_t> &key, const void *handle)
+{
+    push_u64(key, (uint64_t)(uintptr_t)handle);
+}
+
+static void push_float(std::vector<uint32_t> &key, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    key.push_back(bits);
+}
+
+size_t VulkanObjectCache::KeyHash::operator()(const Key &key) const
+{
+    // fnv-1a over the words
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t word : key)
+    {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return size_t(hash);
+}
+
+void VulkanObjectCache::init(VkDevice device)
+{
+    m_device = device;
+}
+
+void VulkanObjectCache::destroy()
+{
+    std::lock_guard lock(m_mutex);
+    spdlog::info("VulkanObjectCache: {} set layouts, {} pipeline layouts, {} samplers, {} cache hits, {} uncached",
+                 m_setLayouts.size(), m_pipelineLayouts.size(), m_samplers.size(), m_hits,
+                 m_uncachedSetLayouts.size() + m_uncachedPipelineLayouts.size() + m_uncachedSamplers.size());
+
+    // pipeline layouts first, they were created from the set layouts
+    for (auto &[key, layout] : m_pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(m_device, layout, nullptr);
+    }
+    for (VkPipelineLayout layout : m_uncachedPipelineLayouts)
+    {
+        vkDestroyPipelineLayout(m_device, layout, nullptr);
+    }
+    for (auto &[key, layout] : m_setLayouts)
+    {
+        vkDestroyDescriptorSetLayout(m_device, layout, nullptr);
+    }
+    for (VkDescriptorSetLayout layout : m_uncachedSetLayouts)
+    {
+        vkDestroyDescriptorSetLayout(m_device, layout, nullptr);
+    }
+    for (auto &[key, sampler] : m_samplers)
+    {
+        vkDestroySampler(m_device, sampler, nullptr);
+    }
+    for (VkSampler sampler : m_uncachedSamplers)
+    {
+        vkDestroySampler(m_device, sampler, nullptr);
+    }
+    m_pipelineLayouts.clear();
+    m_setLayouts.clear();
+    m_samplers.clear();
+    m_uncachedPipelineLayouts.clear();
+    m_uncachedSetLayouts.clear();
+    m_uncachedSamplers.clear();
+    m_hits = 0;
+}
+
+VkDescriptorSetLayout VulkanObjectCache::get_descriptor_set_layout(const VkDescriptorSetLayoutCreateInfo &info)
+{
+    const VkDescriptorBindingFlags *bindingFlags = nullptr;
+    bool keyed = true;
+    for (auto *next = (const VkBaseInStructure *)info.pNext; next; next = next->pNext)
+    {
+        // no flags (bindingCount 0) or one per binding, anything else is not ours to interpret
+        auto *flagsInfo = (const VkDescriptorSetLayoutBindingFlagsCreateInfo *)next;
+        if (next->sType == VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO &&
+            (flagsInfo->bindingCount == 0 || flagsInfo->bindingCount == info.bindingCount))
+        {
+            bindingFlags = flagsInfo->bindingCount ? flagsInfo->pBindingFlags : nullptr;
+        }
+        else
+        {
+            keyed = false;
+        }
+    }
+    if (!keyed)
+    {
+        VkDescriptorSetLayout layout;
+        VK_CHECK(vkCreateDescriptorSetLayout(m_device, &info, nullptr, &layout));
+        std::lock_guard lock(m_mutex);
+        m_uncachedSetLayouts.push_back(layout);
+        return layout;
+    }
+
+    // binding order does not matter to vulkan, so it does not matter to the key either
+    std::vector<uint32_t> order(info.bindingCount);
+    for (uint32_t i = 0; i < info.bindingCount; i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+              { return info.pBindings[a].binding < info.pBindings[b].binding; });
+
+    Key key;
+    key.reserve(2 + info.bindingCount * 5);
+    key.push_back(info.flags);
+    key.push_back(info.bindingCount);
+    for (uint32_t i : order)
+    {
+        const VkDescriptorSetLayoutBinding &binding = info.pBindings[i];
+        key.push_back(binding.binding);
+        key.push_back(binding.descriptorType);
+        key.push_back(binding.descriptorCount);
+        key.push_back(binding.stageFlags);
+        key.push_back(bindingFlags ? bindingFlags[i] : 0);
+        if (binding.pImmutableSamplers)
+        {
+            for (uint32_t s = 0; s < binding.descriptorCount; s++)
+            {
+                push_handle(key, binding.pImmutableSamplers[s]);
+            }
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_setLayouts.find(key);
+    if (it != m_setLayouts.end())
+    {
+        m_hits++;
+        return it->second;
+    }
+
+    VkDescriptorSetLayout layout;
+    VK_CHECK(vkCreateDescriptorSetLayout(m_device, &info, nullptr, &layout));
+    m_setLayouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+VkPipelineLayout VulkanObjectCache::get_pipeline_layout(const VkPipelineLayoutCreateInfo &info)
+{
+    // nothing in a pNext is keyed
+    if (info.pNext)
+    {
+        VkPipelineLayout layout;
+        VK_CHECK(vkCreatePipelineLayout(m_device, &info, nullptr, &layout));
+        std::lock_guard lock(m_mutex);
+        m_uncachedPipelineLayouts.push_back(layout);
+        return layout;
+    }
+
+    Key key;
+    key.reserve(3 + info.setLayoutCount * 2 + info.pushConstantRangeCount * 3);
+    key.push_back(info.flags);
+    key.push_back(info.setLayoutCount);
+    for (uint32_t i = 0; i < info.setLayoutCount; i++)
+    {
+        push_handle(key, info.pSetLayouts[i]);
+    }
+    key.push_back(info.pushConstantRangeCount);
+    for (uint32_t i = 0; i < info.pushConstantRangeCount; i++)
+    {
+        key.push_back(info.pPushConstantRanges[i].stageFlags);
+        key.push_back(info.pPushConstantRanges[i].offset);
+        key.push_back(info.pPushConstantRanges[i].size);
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_pipelineLayouts.find(key);
+    if (it != m_pipelineLayouts.end())
+    {
+        m_hits++;
+        return it->second;
+    }
+
+    VkPipelineLayout layout;
+    VK_CHECK(vkCreatePipelineLayout(m_device, &info, nullptr, &layout));
+    m_pipelineLayouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+VkSampler VulkanObjectCache::get_sampler(const VkSamplerCreateInfo &info)
+{
+    // min / max reduction is keyed, ycbcr conversions, custom border colors etc. are not
+    uint32_t reductionMode = VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE;
+    bool keyed = true;
+    for (auto *next = (const VkBaseInStructure *)info.pNext; next; next = next->pNext)
+    {
+        if (next->sType == VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO)
+        {
+            reductionMode = ((const VkSamplerReductionModeCreateInfo *)next)->reductionMode;
+        }
+        else
+        {
+            keyed = false;
+        }
+    }
+    if (!keyed)
+    {
+        VkSampler sampler;
+        VK_CHECK(vkCreateSampler(m_device, &info, nullptr, &sampler));
+        std::lock_guard lock(m_mutex);
+        m_uncachedSamplers.push_back(sampler);
+        return sampler;
+    }
+
+    Key key;
+    key.reserve(17);
+    key.push_back(info.flags);
+    key.push_back(info.magFilter);
+    key.push_back(info.minFilter);
+    key.push_back(info.mipmapMode);
+    key.push_back(info.addressModeU);
+    key.push_back(info.addressModeV);
+    key.push_back(info.addressModeW);
+    push_float(key, info.mipLodBias);
+    key.push_back(info.anisotropyEnable);
+    push_float(key, info.maxAnisotropy);
+    key.push_back(info.compareEnable);
+    key.push_back(info.compareOp);
+    push_float(key, info.minLod);
+    push_float(key, info.maxLod);
+    key.push_back(info.borderColor);
+    key.push_back(info.unnormalizedCoordinates);
+    key.push_back(reductionMode);
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_samplers.find(key);
+    if (it != m_samplers.end())
+    {
+        m_hits++;
+        return it->second;
+    }
+
+    VkSampler sampler;
+    VK_CHECK(vkCreateSampler(m_device, &info, nullptr, &sampler));
+    m_samplers.emplace(std::move(key), sampler);
+    return sampler;
+}
+
+size_t VulkanObjectCache::descriptor_set_layout_count()
+{
+    std::lock_guard lock(m_mutex);
+    return m_setLayouts.size();
+}
+
+size_t VulkanObjectCache::pipeline_layout_count()
+{
+    std::lock_guard lock(m_mutex);
+    return m_pipelineLayouts.size();
+}
+
+size_t VulkanObjectCache::sampler_count()
+{
+    std::lock_guard lock(m_mutex);
+    return m_samplers.size();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+#include <mutex>
+#include <unordered_map>
+
+// Hash-consed descriptor set layouts, pipeline layouts and samplers.
+// Identical create infos return the same handle, so layouts can be compared by handle
+// and hundreds of materials share a handful of objects. Safe to call from the pipeline
+// compiler threads. The cache owns every handle it returned, destroy() frees them all.
+//
+// Keyed pNext: binding flags of set layouts, reduction mode of samplers. A create info with any other
+// pNext is never shared: it gets its own object, still owned (and destroyed) by the cache.
+class VulkanObjectCache
+{
+public:
+    void init(VkDevice device);
+    void destroy();
+
+    VkDescriptorSetLayout get_descriptor_set_layout(const VkDescriptorSetLayoutCreateInfo &info);
+    // set layouts should come from this cache as well, they are keyed by handle
+    VkPipelineLayout get_pipeline_layout(const VkPipelineLayoutCreateInfo &info);
+    VkSampler get_sampler(const VkSamplerCreateInfo &info);
+
+    size_t descriptor_set_layout_count();
+    size_t pipeline_layout_count();
+    size_t sampler_count();
+
+private:
+    // create info flattened into words, compared in full so hash collisions are harmless
+    using Key = std::vector<uint32_t>;
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    VkDevice m_device{VK_NULL_HANDLE};
+
+    std::mutex m_mutex;
+    std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> m_setLayouts;
+    std::unordered_map<Key, VkPipelineLayout, KeyHash> m_pipelineLayouts;
+    std::unordered_map<Key, VkSampler, KeyHash> m_samplers;
+    // created past the cache because of a pNext the key does not cover
+    std::vector<VkDescriptorSetLayout> m_uncachedSetLayouts;
+    std::vector<VkPipelineLayout> m_uncachedPipelineLayouts;
+    std::vector<VkSampler> m_uncachedSamplers;
+    uint64_t m_hits{0};
+};
@@ -0,0 +1,94 @@
+#include "vk_parallel_recorder.h"
+#include "vk_initializers.h"
+
+void ParallelRecorder::init(const InitInfo &info)
+{
+    ZoneScoped;
+    m_device = info.device;
+    m_jobs = info.jobs;
+    m_workerCount = m_jobs->worker_count();
+
+    // transient: the buffers are re-recorded every time their slot comes around
+    VkCommandPoolCreateInfo poolInfo = vkinit::command_pool_create_info(info.queueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    m_pools.resize(info.frameSlots * m_workerCount);
+    for (auto &pool : m_pools)
+    {
+        VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &pool.pool));
+    }
+    spdlog::info("ParallelRecorder: {} recording workers, {} frame slots", m_workerCount, info.frameSlots);
+}
+
+void ParallelRecorder::destroy()
+{
+    // destroying the pool frees its buffers
+    for (auto &pool : m_pools)
+    {
+        vkDestroyCommandPool(m_device, pool.pool, nullptr);
+    }
+    m_pools.clear();
+}
+
+void ParallelRecorder::begin_frame(uint32_t frameSlot)
+{
+    ZoneScoped;
+    m_frameSlot = frameSlot;
+    for (uint32_t worker = 0; worker < m_workerCount; worker++)
+    {
+        WorkerPool &pool = m_pools[frameSlot * m_workerCount + worker];
+        if (pool.used > 0)
+        {
+            VK_CHECK(vkResetCommandPool(m_device, pool.pool, 0));
+            pool.used = 0;
+        }
+    }
+}
+
+void ParallelRecorder::record(std::span<VkCommandBuffer> out, const Inheritance &inheritance, const RecordFunction &function)
+{
+    ZoneScoped;
+    VkCommandBufferInheritanceInfo inheritanceInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritanceInfo.pNext = inheritance.rendering;
+    VkCommandBufferUsageFlags usage = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (inheritance.rendering)
+    {
+        usage |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+
+    // one buffer per job, the pool belongs to whichever worker picked the job up
+    m_jobs->parallel_for("Record Secondary", (uint32_t)out.size(), 1, [&](uint32_t begin, uint32_t end)
+                         {
+                             for (uint32_t index = begin; index < end; index++)
+                             {
+                                 VkCommandBuffer cmd = next_buffer(JobSystem::worker_index());
+
+                                 VkCommandBufferBeginInfo beginInfo = vkinit::command_buffer_begin_info(usage);
+                                 beginInfo.pInheritanceInfo = &inheritanceInfo;
+                                 VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+                                 function(cmd, index);
+                                 VK_CHECK(vkEndCommandBuffer(cmd));
+                                 out[index] = cmd;
+                             }
+                         });
+}
+
+void ParallelRecorder::execute(VkCommandBuffer primary, std::span<const VkCommandBuffer> secondaries)
+{
+    if (!secondaries.empty())
+    {
+        vkCmdExecuteCommands(primary, (uint32_t)secondaries.size(), secondaries.data());
+    }
+}
+
+VkCommandBuffer ParallelRecorder::next_buffer(uint32_t worker)
+{
+    WorkerPool &pool = m_pools[m_frameSlot * m_workerCount + worker];
+    if (pool.used == pool.buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo = vkinit::command_buffer_allocate_info(pool.pool, 1);
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        VkCommandBuffer cmd;
+        VK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &cmd));
+        pool.buffers.push_back(cmd);
+    }
+    return pool.buffers[pool.used++];
+}
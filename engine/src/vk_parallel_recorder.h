@@ -0,0 +1,66 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "job_system.h"
+
+// Records secondary command buffers on the job system's workers.
+// Every worker owns one command pool per frame slot, so recording never shares a pool between
+// threads. record() runs one job per secondary command buffer, and the buffers come back in job
+// order for vkCmdExecuteCommands.
+// Secondaries do not inherit bound state: every job has to bind its pipeline and descriptors.
+class ParallelRecorder
+{
+public:
+    struct InitInfo
+    {
+        VkDevice device;
+        // family of the queue the primaries are submitted to
+        uint32_t queueFamily;
+        uint32_t frameSlots;
+        JobSystem *jobs;
+    };
+
+    // what the secondaries continue from the primary
+    struct Inheritance
+    {
+        // dynamic rendering the secondaries are executed in (the primary begins it with
+        // VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT), nullptr = outside of rendering
+        const VkCommandBufferInheritanceRenderingInfo *rendering{nullptr};
+    };
+
+    // records job index into cmd, runs on any worker
+    using RecordFunction = std::function<void(VkCommandBuffer cmd, uint32_t index)>;
+
+    void init(const InitInfo &info);
+    // destroys the pools
+    void destroy();
+
+    // resets the slot's pools, call once the slot's previous frame retired
+    void begin_frame(uint32_t frameSlot);
+
+    // records out.size() jobs concurrently and blocks until all are done. out receives the recorded
+    // buffers in job order, valid until the slot's next begin_frame(). call it from a job system worker
+    void record(std::span<VkCommandBuffer> out, const Inheritance &inheritance, const RecordFunction &function);
+    // records the secondaries into the primary, in order
+    static void execute(VkCommandBuffer primary, std::span<const VkCommandBuffer> secondaries);
+
+    uint32_t worker_count() const { return m_workerCount; }
+
+private:
+    struct WorkerPool
+    {
+        VkCommandPool pool{VK_NULL_HANDLE};
+        // allocated from pool, reused after every reset
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t used{0};
+    };
+
+    VkCommandBuffer next_buffer(uint32_t worker);
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    JobSystem *m_jobs{nullptr};
+    uint32_t m_workerCount{1};
+    uint32_t m_frameSlot{0};
+    // frameSlots * m_workerCount, slot major
+    std::vector<WorkerPool> m_pools;
+};
@@ -0,0 +1,190 @@
+#include "vk_pipeline_compiler.h"
+#include "vk_pipelines.h"
+
+void PipelineCompiler::init(VkDevice device, VkPipelineCache cache, JobSystem &jobs, uint32_t maxConcurrent)
+{
+    ZoneScoped;
+    m_device = device;
+    m_cache = cache;
+    m_jobSystem = &jobs;
+    m_stop = false;
+
+    if (maxConcurrent == 0)
+    {
+        uint32_t workers = jobs.worker_count();
+        maxConcurrent = workers > 1 ? workers - 1 : 1;
+    }
+    m_maxConcurrent = maxConcurrent;
+    spdlog::info("PipelineCompiler: up to {} compiles on {} job workers", m_maxConcurrent, jobs.worker_count());
+}
+
+void PipelineCompiler::destroy()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+        m_pending -= (uint32_t)m_jobs.size();
+        m_jobs.clear();
+    }
+    if (m_jobSystem)
+    {
+        m_jobSystem->wait(m_counter);
+    }
+
+    for (auto &state : m_states)
+    {
+        if (state->status.load(std::memory_order_acquire) == PipelineHandle::Status::Ready)
+        {
+            vkDestroyPipeline(m_device, state->pipeline, nullptr);
+        }
+        state->pipeline = VK_NULL_HANDLE;
+        state->status = PipelineHandle::Status::Failed;
+    }
+    m_states.clear();
+}
+
+PipelineHandle PipelineCompiler::compile(const std::string &name, BuildFunction &&build)
+{
+    PipelineHandle handle;
+    handle.m_state = std::make_shared<PipelineHandle::State>();
+    handle.m_state->name = name;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_pending.load() == 0)
+        {
+            m_batchStart = std::chrono::steady_clock::now();
+            m_batchCompileMs = 0.0;
+            m_batchCount = 0;
+        }
+        m_pending++;
+        m_states.push_back(handle.m_state);
+        m_jobs.push_back({handle.m_state, std::move(build)});
+        dispatch();
+    }
+    return handle;
+}
+
+PipelineHandle PipelineCompiler::compile_compute(const std::string &name, const std::string &shaderPath, VkPipelineLayout layout)
+{
+    return compile(name, [shaderPath, layout](VkDevice device, VkPipelineCache cache)
+                   {
+        VkShaderModule computeShader;
+        if (!vkutil::load_shader_module(shaderPath.c_str(), device, &computeShader))
+        {
+            spdlog::error("Error when building shader {}", shaderPath);
+            return (VkPipeline)VK_NULL_HANDLE;
+        }
+
+        VkPipelineShaderStageCreateInfo stageinfo{};
+        stageinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageinfo.pNext = nullptr;
+        stageinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        stageinfo.module = computeShader;
+        stageinfo.pName = "main";
+
+        VkComputePipelineCreateInfo computePipelineCreateInfo{};
+        computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCreateInfo.pNext = nullptr;
+        computePipelineCreateInfo.layout = layout;
+        computePipelineCreateInfo.stage = stageinfo;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkResult result = vkCreateComputePipelines(device, cache, 1, &computePipelineCreateInfo, nullptr, &pipeline);
+        vkDestroyShaderModule(device, computeShader, nullptr);
+        return result == VK_SUCCESS ? pipeline : (VkPipeline)VK_NULL_HANDLE; });
+}
+
+PipelineHandle PipelineCompiler::compile_graphics(const std::string &name, const std::string &vertexPath, const std::string &fragmentPath,
+                                                  const PipelineBuilder &builder)
+{
+    return compile(name, [vertexPath, fragmentPath, builder](VkDevice device, VkPipelineCache cache) mutable
+                   {
+        VkShaderModule vertexShader;
+        if (!vkutil::load_shader_module(vertexPath.c_str(), device, &vertexShader))
+        {
+            spdlog::error("Error when building shader {}", vertexPath);
+            return (VkPipeline)VK_NULL_HANDLE;
+        }
+        VkShaderModule fragmentShader;
+        if (!vkutil::load_shader_module(fragmentPath.c_str(), device, &fragmentShader))
+        {
+            spdlog::error("Error when building shader {}", fragmentPath);
+            vkDestroyShaderModule(device, vertexShader, nullptr);
+            return (VkPipeline)VK_NULL_HANDLE;
+        }
+
+        builder.set_shaders(vertexShader, fragmentShader);
+        VkPipeline pipeline = builder.build_pipeline(device, cache);
+        vkDestroyShaderModule(device, vertexShader, nullptr);
+        vkDestroyShaderModule(device, fragmentShader, nullptr);
+        return pipeline; });
+}
+
+void PipelineCompiler::wait_idle()
+{
+    ZoneScoped;
+    m_jobSystem->wait(m_counter);
+}
+
+void PipelineCompiler::dispatch()
+{
+    while (m_running < m_maxConcurrent && !m_jobs.empty())
+    {
+        m_running++;
+        // the job holds the build function, a std::function has to be copyable
+        auto job = std::make_shared<Job>(std::move(m_jobs.front()));
+        m_jobs.pop_front();
+        m_jobSystem->schedule("Compile Pipeline", [this, job]
+                              { run(*job); }, &m_counter);
+    }
+}
+
+void PipelineCompiler::run(Job &job)
+{
+    bool stopped;
+    {
+        std::lock_guard lock(m_mutex);
+        stopped = m_stop;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (!stopped)
+    {
+        ZoneScopedN("Compile Pipeline");
+        ZoneText(job.state->name.c_str(), job.state->name.size());
+        pipeline = job.build(m_device, m_cache);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    job.state->pipeline = pipeline;
+    job.state->status.store(pipeline != VK_NULL_HANDLE ? PipelineHandle::Status::Ready : PipelineHandle::Status::Failed,
+                            std::memory_order_release);
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        if (!stopped)
+        {
+            spdlog::error("PipelineCompiler: {} failed", job.state->name);
+        }
+    }
+    else
+    {
+        spdlog::debug("PipelineCompiler: {} ready in {:.2f} ms", job.state->name, elapsed.count());
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_running--;
+    m_batchCompileMs += elapsed.count();
+    m_batchCount++;
+    if (--m_pending == 0)
+    {
+        std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - m_batchStart;
+        spdlog::info("PipelineCompiler: {} pipelines in {:.2f} ms ({:.2f} ms compile time, up to {} at once)",
+                     m_batchCount, wall.count(), m_batchCompileMs, m_maxConcurrent);
+    }
+    // the next compile is scheduled before this job finishes, so the counter stays above zero
+    if (!m_stop)
+    {
+        dispatch();
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "vk_pipelines.h"
+#include "job_system.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+// Result of an asynchronous pipeline compile. Cheap to copy, get() stays VK_NULL_HANDLE
+// until a worker finished the pipeline, so draws can skip or use a fallback meanwhile.
+class PipelineHandle
+{
+public:
+    enum class Status : uint8_t
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    bool valid() const { return m_state != nullptr; }
+    bool ready() const { return status() == Status::Ready; }
+    bool failed() const { return status() == Status::Failed; }
+    Status status() const { return m_state ? m_state->status.load(std::memory_order_acquire) : Status::Failed; }
+    VkPipeline get() const { return ready() ? m_state->pipeline : VK_NULL_HANDLE; }
+    const std::string &name() const { return m_state->name; }
+
+private:
+    friend class PipelineCompiler;
+
+    struct State
+    {
+        std::string name;
+        VkPipeline pipeline{VK_NULL_HANDLE};
+        std::atomic<Status> status{Status::Pending};
+    };
+    std::shared_ptr<State> m_state;
+};
+
+// Compiles pipelines as job system jobs against the shared (internally synchronized) pipeline cache.
+// At most maxConcurrent compiles run at once, the rest wait in the compiler's queue, so a burst of
+// pipelines (startup, streaming) leaves workers for the frame's jobs.
+// The compiler owns every pipeline it built and destroys them in destroy().
+class PipelineCompiler
+{
+public:
+    // creates the pipeline, returns VK_NULL_HANDLE on failure. runs on a worker thread
+    using BuildFunction = std::function<VkPipeline(VkDevice device, VkPipelineCache cache)>;
+
+    // maxConcurrent 0 = job system workers - 1. the job system has to outlive the compiler
+    void init(VkDevice device, VkPipelineCache cache, JobSystem &jobs, uint32_t maxConcurrent = 0);
+    // drops compiles that did not start yet, waits for the running ones and destroys the pipelines
+    void destroy();
+
+    PipelineHandle compile(const std::string &name, BuildFunction &&build);
+    // loads the spir-v on the worker as well
+    PipelineHandle compile_compute(const std::string &name, const std::string &shaderPath, VkPipelineLayout layout);
+    // builder holds everything but the shaders, they are loaded on the worker as well
+    PipelineHandle compile_graphics(const std::string &name, const std::string &vertexPath, const std::string &fragmentPath,
+                                    const PipelineBuilder &builder);
+
+    // blocks until every queued pipeline is done, a worker runs jobs meanwhile
+    void wait_idle();
+    uint32_t pending() const { return m_pending.load(std::memory_order_acquire); }
+
+private:
+    struct Job
+    {
+        std::shared_ptr<PipelineHandle::State> state;
+        BuildFunction build;
+    };
+
+    // hands queued compiles to the job system up to m_maxConcurrent. m_mutex must be held
+    void dispatch();
+    void run(Job &job);
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    VkPipelineCache m_cache{VK_NULL_HANDLE};
+    JobSystem *m_jobSystem{nullptr};
+
+    uint32_t m_maxConcurrent{1};
+    uint32_t m_running{0};
+    std::deque<Job> m_jobs;
+    std::mutex m_mutex;
+    // every compile handed to the job system, queued ones are dispatched before it can reach zero
+    JobSystem::Counter m_counter;
+    bool m_stop{false};
+    std::atomic<uint32_t> m_pending{0};
+
+    // every handed out pipeline, for destroy()
+    std::vector<std::shared_ptr<PipelineHandle::State>> m_states;
+
+    // startup / batch timing: a batch runs from the first job on an idle compiler until it is idle again
+    std::chrono::steady_clock::time_point m_batchStart;
+    double m_batchCompileMs{0.0};
+    uint32_t m_batchCount{0};
+};
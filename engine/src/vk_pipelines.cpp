@@ -1,4 +1,6 @@
 #include "vk_pipelines.h"
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include "vk_initializers.h"
 
@@ -48,3 +50,303 @@ bool vkutil::load_shader_module(const char* filePath,
     *outShaderModule = shaderModule;
     return true;
 }
+
+void PipelineBuilder::clear()
+{
+    // clear all of the structs we need back to 0 with their correct stype
+    m_inputAssembly = { .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+    m_rasterizer = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    m_colorBlendAttachment = {};
+    m_multisampling = { .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+    m_pipelineLayout = VK_NULL_HANDLE;
+    // zeroed = depth test and writes disabled
+    m_depthStencil = { .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+    m_renderInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
+    m_colorAttachmentFormat = VK_FORMAT_UNDEFINED;
+    m_shaderStages.clear();
+}
+
+VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkPipelineCache cache)
+{
+    // one viewport and scissor, both dynamic
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.pNext = nullptr;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    // no transparent objects yet, the blending is just "no blend" into the color attachment if there is one
+    const uint32_t colorAttachmentCount = m_colorAttachmentFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.pNext = nullptr;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = colorAttachmentCount;
+    colorBlending.pAttachments = &m_colorBlendAttachment;
+
+    // vertices are pulled through buffer device addresses, nothing to describe here
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+
+    VkDynamicState state[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+    dynamicInfo.pDynamicStates = &state[0];
+    dynamicInfo.dynamicStateCount = 2;
+
+    // the rendering info replaces the render pass, it points at our color format.
+    // no color format = depth only
+    VkPipelineRenderingCreateInfo renderInfo = m_renderInfo;
+    renderInfo.colorAttachmentCount = colorAttachmentCount;
+    renderInfo.pColorAttachmentFormats = &m_colorAttachmentFormat;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = { .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+    pipelineInfo.pNext = &renderInfo;
+    pipelineInfo.stageCount = (uint32_t)m_shaderStages.size();
+    pipelineInfo.pStages = m_shaderStages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &m_inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &m_rasterizer;
+    pipelineInfo.pMultisampleState = &m_multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDepthStencilState = &m_depthStencil;
+    pipelineInfo.pDynamicState = &dynamicInfo;
+    pipelineInfo.layout = m_pipelineLayout;
+
+    VkPipeline newPipeline;
+    if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+        spdlog::error("failed to create graphics pipeline");
+        return VK_NULL_HANDLE;
+    }
+    return newPipeline;
+}
+
+void PipelineBuilder::set_shaders(VkShaderModule vertexShader, VkShaderModule fragmentShader)
+{
+    m_shaderStages.clear();
+
+    VkPipelineShaderStageCreateInfo stage = { .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+    stage.pName = "main";
+    stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stage.module = vertexShader;
+    m_shaderStages.push_back(stage);
+
+    stage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stage.module = fragmentShader;
+    m_shaderStages.push_back(stage);
+}
+
+void PipelineBuilder::set_input_topology(VkPrimitiveTopology topology)
+{
+    m_inputAssembly.topology = topology;
+    // only for strips
+    m_inputAssembly.primitiveRestartEnable = VK_FALSE;
+}
+
+void PipelineBuilder::set_polygon_mode(VkPolygonMode mode)
+{
+    m_rasterizer.polygonMode = mode;
+    m_rasterizer.lineWidth = 1.f;
+}
+
+void PipelineBuilder::set_cull_mode(VkCullModeFlags cullMode, VkFrontFace frontFace)
+{
+    m_rasterizer.cullMode = cullMode;
+    m_rasterizer.frontFace = frontFace;
+}
+
+void PipelineBuilder::set_multisampling_none()
+{
+    m_multisampling.sampleShadingEnable = VK_FALSE;
+    // 1 sample per pixel
+    m_multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    m_multisampling.minSampleShading = 1.0f;
+    m_multisampling.pSampleMask = nullptr;
+    m_multisampling.alphaToCoverageEnable = VK_FALSE;
+    m_multisampling.alphaToOneEnable = VK_FALSE;
+}
+
+void PipelineBuilder::disable_blending()
+{
+    // default write mask, no blending
+    m_colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    m_colorBlendAttachment.blendEnable = VK_FALSE;
+}
+
+void PipelineBuilder::set_color_attachment_format(VkFormat format)
+{
+    m_colorAttachmentFormat = format;
+}
+
+void PipelineBuilder::set_depth_format(VkFormat format)
+{
+    m_renderInfo.depthAttachmentFormat = format;
+}
+
+void PipelineBuilder::enable_depthtest(bool depthWriteEnable, VkCompareOp op)
+{
+    m_depthStencil.depthTestEnable = VK_TRUE;
+    m_depthStencil.depthWriteEnable = depthWriteEnable;
+    m_depthStencil.depthCompareOp = op;
+    m_depthStencil.depthBoundsTestEnable = VK_FALSE;
+    m_depthStencil.stencilTestEnable = VK_FALSE;
+    m_depthStencil.front = {};
+    m_depthStencil.back = {};
+    m_depthStencil.minDepthBounds = 0.f;
+    m_depthStencil.maxDepthBounds = 1.f;
+}
+
+static constexpr uint32_t kPipelineCacheMagic = 0x43504655; // "UFPC"
+static constexpr uint32_t kPipelineCacheFileVersion = 1;
+
+// fnv-1a, catches truncated or partially written blobs
+static uint64_t hash_blob(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool PipelineCache::header_matches(const FileHeader& header) const
+{
+    return header.magic == kPipelineCacheMagic
+        && header.version == kPipelineCacheFileVersion
+        && header.vendorID == m_properties.vendorID
+        && header.deviceID == m_properties.deviceID
+        && header.driverVersion == m_properties.driverVersion
+        && std::memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+std::vector<char> PipelineCache::load_blob() const
+{
+    std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        spdlog::info("PipelineCache: no cache at {}, starting empty", m_path);
+        return {};
+    }
+    size_t fileSize = (size_t)file.tellg();
+    file.seekg(0);
+
+    FileHeader header{};
+    if (fileSize < sizeof(FileHeader) || !file.read((char*)&header, sizeof(FileHeader))) {
+        spdlog::warn("PipelineCache: {} is too small, ignoring it", m_path);
+        return {};
+    }
+    if (!header_matches(header)) {
+        spdlog::info("PipelineCache: {} was written by another device or driver, ignoring it", m_path);
+        return {};
+    }
+    if (header.dataSize != fileSize - sizeof(FileHeader)) {
+        spdlog::warn("PipelineCache: {} is truncated, ignoring it", m_path);
+        return {};
+    }
+
+    std::vector<char> blob(header.dataSize);
+    file.read(blob.data(), blob.size());
+    if (!file || hash_blob(blob.data(), blob.size()) != header.dataHash) {
+        spdlog::warn("PipelineCache: {} is corrupt, ignoring it", m_path);
+        return {};
+    }
+
+    // the driver checks its own header too, but a mismatch there should not even reach it
+    VkPipelineCacheHeaderVersionOne vkHeader{};
+    if (blob.size() < sizeof(vkHeader)) {
+        return {};
+    }
+    std::memcpy(&vkHeader, blob.data(), sizeof(vkHeader));
+    if (vkHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        || vkHeader.vendorID != m_properties.vendorID
+        || vkHeader.deviceID != m_properties.deviceID
+        || std::memcmp(vkHeader.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        spdlog::info("PipelineCache: driver header of {} does not match, ignoring it", m_path);
+        return {};
+    }
+    return blob;
+}
+
+void PipelineCache::init(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& path)
+{
+    ZoneScoped;
+    m_device = device;
+    m_properties = properties;
+    m_path = path;
+
+    std::vector<char> blob;
+    if (!m_path.empty()) {
+        blob = load_blob();
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    cacheInfo.initialDataSize = blob.size();
+    cacheInfo.pInitialData = blob.empty() ? nullptr : blob.data();
+
+    if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+        // the driver rejected the data after all, start over without it
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        VK_CHECK(vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache));
+        blob.clear();
+    }
+    if (!blob.empty()) {
+        spdlog::info("PipelineCache: loaded {} KiB from {}", blob.size() / 1024, m_path);
+    }
+}
+
+bool PipelineCache::save()
+{
+    ZoneScoped;
+    if (m_cache == VK_NULL_HANDLE || m_path.empty()) {
+        return false;
+    }
+
+    size_t dataSize = 0;
+    VK_CHECK(vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr));
+    std::vector<char> blob(dataSize);
+    VK_CHECK(vkGetPipelineCacheData(m_device, m_cache, &dataSize, blob.data()));
+    blob.resize(dataSize);
+
+    FileHeader header{};
+    header.magic = kPipelineCacheMagic;
+    header.version = kPipelineCacheFileVersion;
+    header.vendorID = m_properties.vendorID;
+    header.deviceID = m_properties.deviceID;
+    header.driverVersion = m_properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = blob.size();
+    header.dataHash = hash_blob(blob.data(), blob.size());
+
+    const std::string tmpPath = m_path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            spdlog::error("PipelineCache: could not open {} for writing", tmpPath);
+            return false;
+        }
+        file.write((const char*)&header, sizeof(header));
+        file.write(blob.data(), blob.size());
+        if (!file.good()) {
+            spdlog::error("PipelineCache: writing {} failed", tmpPath);
+            return false;
+        }
+    }
+
+    // rename replaces the old file in one step
+    std::error_code error;
+    std::filesystem::rename(tmpPath, m_path, error);
+    if (error) {
+        spdlog::error("PipelineCache: could not replace {}: {}", m_path, error.message());
+        std::filesystem::remove(tmpPath, error);
+        return false;
+    }
+    spdlog::info("PipelineCache: wrote {} KiB to {}", blob.size() / 1024, m_path);
+    return true;
+}
+
+void PipelineCache::destroy()
+{
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    m_cache = VK_NULL_HANDLE;
+}
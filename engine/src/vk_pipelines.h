@@ -6,4 +6,81 @@ namespace vkutil {
 bool load_shader_module(const char* filePath,
     VkDevice device,
     VkShaderModule* outShaderModule);
-};
\ No newline at end of file
+};
+
+// Graphics pipeline state for dynamic rendering, filled by the setters and built in one call.
+// No vertex input state: meshes pull their vertices from buffer device addresses.
+// Viewport and scissor are dynamic. Copyable, so a configured builder can be handed to a
+// PipelineCompiler worker.
+class PipelineBuilder
+{
+public:
+    PipelineBuilder() { clear(); }
+
+    // back to no shaders, no color / depth attachment and the depth test disabled
+    void clear();
+
+    // VK_NULL_HANDLE on failure. the shader modules stay owned by the caller
+    VkPipeline build_pipeline(VkDevice device, VkPipelineCache cache = VK_NULL_HANDLE);
+
+    void set_shaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    void set_input_topology(VkPrimitiveTopology topology);
+    void set_polygon_mode(VkPolygonMode mode);
+    void set_cull_mode(VkCullModeFlags cullMode, VkFrontFace frontFace);
+    void set_multisampling_none();
+    void disable_blending();
+    // VK_FORMAT_UNDEFINED = no color attachment
+    void set_color_attachment_format(VkFormat format);
+    void set_depth_format(VkFormat format);
+    void enable_depthtest(bool depthWriteEnable, VkCompareOp op);
+    void set_layout(VkPipelineLayout layout) { m_pipelineLayout = layout; }
+
+private:
+    std::vector<VkPipelineShaderStageCreateInfo> m_shaderStages;
+
+    VkPipelineInputAssemblyStateCreateInfo m_inputAssembly;
+    VkPipelineRasterizationStateCreateInfo m_rasterizer;
+    VkPipelineColorBlendAttachmentState m_colorBlendAttachment;
+    VkPipelineMultisampleStateCreateInfo m_multisampling;
+    VkPipelineLayout m_pipelineLayout;
+    VkPipelineDepthStencilStateCreateInfo m_depthStencil;
+    VkPipelineRenderingCreateInfo m_renderInfo;
+    VkFormat m_colorAttachmentFormat;
+};
+
+// VkPipelineCache persisted between runs.
+// The blob on disk starts with our own header (device, driver version, cache uuid, size, checksum);
+// anything that does not match the current device / driver is ignored and the cache starts empty.
+// Pipeline caches are internally synchronized, all pipeline creation can share the handle from any thread.
+class PipelineCache
+{
+public:
+    // empty path = in-memory cache only
+    void init(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& path);
+    // writes the cache next to the target file and renames it over the old one, so a crash never leaves a torn file
+    bool save();
+    void destroy();
+
+    VkPipelineCache handle() const { return m_cache; }
+
+private:
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    bool header_matches(const FileHeader& header) const;
+    std::vector<char> load_blob() const;
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    VkPhysicalDeviceProperties m_properties{};
+    std::string m_path;
+    VkPipelineCache m_cache{VK_NULL_HANDLE};
+};
@@ -0,0 +1,250 @@
+#include "vk_profiler.h"
+
+#include "defines.h"
+
+#include <algorithm>
+
+#if KPLATFORM_WINDOWS
+#include <windows.h>
+#endif
+
+// the cpu time domain that matches std::chrono::steady_clock on this platform
+#if KPLATFORM_WINDOWS
+static constexpr VkTimeDomainEXT kSteadyClockDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+static constexpr VkTimeDomainEXT kSteadyClockDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+
+static uint64_t cpu_domain_to_ns(uint64_t ticks)
+{
+#if KPLATFORM_WINDOWS
+    // steady_clock is QueryPerformanceCounter scaled to nanoseconds
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return uint64_t((double)ticks * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    // CLOCK_MONOTONIC is already in nanoseconds
+    return ticks;
+#endif
+}
+
+void GpuProfiler::init(const InitInfo &info)
+{
+    ZoneScoped;
+    m_device = info.device;
+    m_physicalDevice = info.physicalDevice;
+    m_timestampPeriod = info.timestampPeriod;
+    m_enabled = info.timestampValidBits > 0;
+    if (!m_enabled)
+    {
+        spdlog::warn("GpuProfiler: queue does not support timestamps, gpu timings disabled");
+        return;
+    }
+    m_timestampMask = info.timestampValidBits >= 64 ? ~0ull : ((1ull << info.timestampValidBits) - 1);
+
+    VkQueryPoolCreateInfo queryPoolInfo = {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = MAX_SCOPES * 2;
+
+    m_frames.resize(info.frameSlots);
+    for (auto &frame : m_frames)
+    {
+        VK_CHECK(vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &frame.pool));
+        frame.names.reserve(MAX_SCOPES);
+        frame.depths.reserve(MAX_SCOPES);
+    }
+    m_readback.reserve(MAX_SCOPES * 2);
+    m_lastResults.reserve(MAX_SCOPES);
+
+    if (info.calibratedTimestamps)
+    {
+        m_getTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(info.instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+        m_getCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(m_device, "vkGetCalibratedTimestampsEXT");
+    }
+    if (m_getTimeDomains && m_getCalibratedTimestamps)
+    {
+        uint32_t domainCount = 0;
+        m_getTimeDomains(m_physicalDevice, &domainCount, nullptr);
+        std::vector<VkTimeDomainEXT> domains(domainCount);
+        m_getTimeDomains(m_physicalDevice, &domainCount, domains.data());
+
+        bool hasDevice = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+        bool hasCpu = std::find(domains.begin(), domains.end(), kSteadyClockDomain) != domains.end();
+        m_cpuTimeDomain = kSteadyClockDomain;
+        m_calibrated = hasDevice && hasCpu;
+    }
+
+    if (m_calibrated)
+    {
+        m_tracyContext = TracyVkContextCalibrated(m_physicalDevice, m_device, info.queue, info.setupCommandBuffer, m_getTimeDomains, m_getCalibratedTimestamps);
+    }
+    else
+    {
+        m_tracyContext = TracyVkContext(m_physicalDevice, m_device, info.queue, info.setupCommandBuffer);
+    }
+    calibrate();
+
+    spdlog::info("GpuProfiler: {} frame slots, {} scopes each, clocks {}calibrated", info.frameSlots, MAX_SCOPES, m_calibrated ? "" : "not ");
+}
+
+void GpuProfiler::destroy()
+{
+    if (m_tracyContext)
+    {
+        TracyVkDestroy(m_tracyContext);
+        m_tracyContext = nullptr;
+    }
+    for (auto &frame : m_frames)
+    {
+        vkDestroyQueryPool(m_device, frame.pool, nullptr);
+    }
+    m_frames.clear();
+    m_enabled = false;
+}
+
+void GpuProfiler::begin_frame(VkCommandBuffer cmd, uint32_t frameSlot)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+    m_currentSlot = frameSlot;
+    FrameQueries &frame = m_frames[frameSlot];
+    frame.scopeCount = 0;
+    frame.names.clear();
+    frame.depths.clear();
+    m_depth = 0;
+
+    vkCmdResetQueryPool(cmd, frame.pool, 0, MAX_SCOPES * 2);
+    m_frameScope = begin_scope(cmd, "Frame");
+}
+
+void GpuProfiler::end_frame(VkCommandBuffer cmd)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+    end_scope(cmd, m_frameScope);
+    m_frameScope = INVALID_SCOPE;
+    m_frames[m_currentSlot].pending = true;
+
+    if (m_tracyContext)
+    {
+        TracyVkCollect(m_tracyContext, cmd);
+    }
+}
+
+uint32_t GpuProfiler::begin_scope(VkCommandBuffer cmd, const char *name, VkPipelineStageFlags2 stage)
+{
+    if (!m_enabled)
+    {
+        return INVALID_SCOPE;
+    }
+    FrameQueries &frame = m_frames[m_currentSlot];
+    if (frame.scopeCount >= MAX_SCOPES)
+    {
+        return INVALID_SCOPE;
+    }
+    uint32_t scope = frame.scopeCount++;
+    frame.names.push_back(name);
+    frame.depths.push_back(m_depth++);
+
+    vkCmdWriteTimestamp2(cmd, stage, frame.pool, scope * 2);
+    return scope;
+}
+
+void GpuProfiler::end_scope(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlags2 stage)
+{
+    if (scope == INVALID_SCOPE)
+    {
+        return;
+    }
+    m_depth--;
+    vkCmdWriteTimestamp2(cmd, stage, m_frames[m_currentSlot].pool, scope * 2 + 1);
+}
+
+bool GpuProfiler::collect(uint32_t frameSlot)
+{
+    ZoneScoped;
+    if (!m_enabled || !m_frames[frameSlot].pending)
+    {
+        return false;
+    }
+    FrameQueries &frame = m_frames[frameSlot];
+    frame.pending = false;
+
+    uint32_t queryCount = frame.scopeCount * 2;
+    m_readback.resize(queryCount);
+    VkResult result = vkGetQueryPoolResults(m_device, frame.pool, 0, queryCount, queryCount * sizeof(uint64_t), m_readback.data(),
+                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    calibrate();
+
+    m_lastResults.clear();
+    for (uint32_t i = 0; i < frame.scopeCount; i++)
+    {
+        uint64_t begin = m_readback[i * 2];
+        uint64_t end = m_readback[i * 2 + 1];
+        uint64_t ticks = (end - begin) & m_timestampMask;
+
+        ScopeTiming timing{};
+        timing.name = frame.names[i];
+        timing.depth = frame.depths[i];
+        timing.ms = double(ticks) * m_timestampPeriod / 1000000.0;
+        if (m_calibrated)
+        {
+            timing.cpuBegin = gpu_to_cpu(begin);
+            timing.cpuEnd = gpu_to_cpu(end);
+        }
+        m_lastResults.push_back(timing);
+    }
+    return true;
+}
+
+double GpuProfiler::pass_ms(std::string_view name) const
+{
+    for (const auto &timing : m_lastResults)
+    {
+        if (name == timing.name)
+        {
+            return timing.ms;
+        }
+    }
+    return -1.0;
+}
+
+void GpuProfiler::calibrate()
+{
+    if (!m_calibrated)
+    {
+        return;
+    }
+    VkCalibratedTimestampInfoEXT infos[2] = {};
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[1].timeDomain = m_cpuTimeDomain;
+
+    uint64_t timestamps[2];
+    uint64_t maxDeviation;
+    if (m_getCalibratedTimestamps(m_device, 2, infos, timestamps, &maxDeviation) != VK_SUCCESS)
+    {
+        return;
+    }
+    m_calibrationGpu = timestamps[0];
+    m_calibrationCpuNs = cpu_domain_to_ns(timestamps[1]);
+}
+
+std::chrono::steady_clock::time_point GpuProfiler::gpu_to_cpu(uint64_t gpuTicks) const
+{
+    // signed so timestamps taken before the calibration point map correctly
+    int64_t deltaTicks = int64_t(gpuTicks - m_calibrationGpu);
+    int64_t cpuNs = int64_t(m_calibrationCpuNs) + int64_t(double(deltaTicks) * m_timestampPeriod);
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(cpuNs)));
+}
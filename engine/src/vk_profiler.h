@@ -0,0 +1,133 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+#include <chrono>
+#include <string_view>
+
+#include <tracy/TracyVulkan.hpp>
+
+// GPU timestamp profiler.
+// Every frame slot owns a timestamp query pool; named scopes write a begin/end
+// timestamp pair into it and the results are read back once the slot's frame
+// has retired. The same scopes are forwarded to tracy as GPU zones.
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t MAX_SCOPES = 32;
+
+    struct ScopeTiming
+    {
+        const char *name;
+        uint32_t depth;
+        double ms;
+        // begin / end of the scope on the cpu clock (steady_clock), only valid when calibrated
+        std::chrono::steady_clock::time_point cpuBegin;
+        std::chrono::steady_clock::time_point cpuEnd;
+    };
+
+    struct InitInfo
+    {
+        VkInstance instance;
+        VkPhysicalDevice physicalDevice;
+        VkDevice device;
+        VkQueue queue;
+        // command buffer tracy can use to set up its context, must be resettable
+        VkCommandBuffer setupCommandBuffer;
+        uint32_t frameSlots;
+        float timestampPeriod;
+        uint32_t timestampValidBits;
+        // VK_EXT_calibrated_timestamps was enabled on the device
+        bool calibratedTimestamps;
+    };
+
+    void init(const InitInfo &info);
+    void destroy();
+
+    bool enabled() const { return m_enabled; }
+    bool calibrated() const { return m_calibrated; }
+
+    // resets the slot's queries and opens the "Frame" scope
+    void begin_frame(VkCommandBuffer cmd, uint32_t frameSlot);
+    // closes the "Frame" scope and lets tracy collect finished zones
+    void end_frame(VkCommandBuffer cmd);
+
+    // returns the scope index to hand to end_scope, INVALID_SCOPE when the pool is full
+    uint32_t begin_scope(VkCommandBuffer cmd, const char *name, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
+    void end_scope(VkCommandBuffer cmd, uint32_t scope, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+
+    // reads back the slot's results. call only after the slot's frame finished executing
+    bool collect(uint32_t frameSlot);
+
+    // timings of the most recently collected frame, the first entry is the whole frame
+    const std::vector<ScopeTiming> &last_results() const { return m_lastResults; }
+    double last_frame_ms() const { return m_lastResults.empty() ? 0.0 : m_lastResults.front().ms; }
+    // gpu milliseconds of the named scope in the last collected frame, negative if it was not recorded
+    double pass_ms(std::string_view name) const;
+
+    // maps a raw gpu timestamp onto the cpu steady clock using the last calibration
+    std::chrono::steady_clock::time_point gpu_to_cpu(uint64_t gpuTicks) const;
+    // re-samples the cpu / gpu clock pair, cheap enough to do once per frame
+    void calibrate();
+
+    TracyVkCtx tracy_context() const { return m_tracyContext; }
+
+    static constexpr uint32_t INVALID_SCOPE = ~0u;
+
+private:
+    struct FrameQueries
+    {
+        VkQueryPool pool{VK_NULL_HANDLE};
+        std::vector<const char *> names;
+        std::vector<uint32_t> depths;
+        uint32_t scopeCount{0};
+        bool pending{false};
+    };
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    VkPhysicalDevice m_physicalDevice{VK_NULL_HANDLE};
+    bool m_enabled{false};
+    bool m_calibrated{false};
+    float m_timestampPeriod{1.0f};
+    uint64_t m_timestampMask{~0ull};
+
+    std::vector<FrameQueries> m_frames;
+    uint32_t m_currentSlot{0};
+    uint32_t m_frameScope{INVALID_SCOPE};
+    uint32_t m_depth{0};
+
+    std::vector<ScopeTiming> m_lastResults;
+    std::vector<uint64_t> m_readback;
+
+    // calibrated clock pair: gpu ticks / cpu nanoseconds on the steady clock
+    VkTimeDomainEXT m_cpuTimeDomain{VK_TIME_DOMAIN_DEVICE_EXT};
+    uint64_t m_calibrationGpu{0};
+    uint64_t m_calibrationCpuNs{0};
+    PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT m_getTimeDomains{nullptr};
+    PFN_vkGetCalibratedTimestampsEXT m_getCalibratedTimestamps{nullptr};
+
+    TracyVkCtx m_tracyContext{nullptr};
+};
+
+// RAII scope pairing a GpuProfiler scope with its tracy gpu zone
+class GpuScope
+{
+public:
+    GpuScope(GpuProfiler &profiler, VkCommandBuffer cmd, const char *name)
+        : m_profiler(profiler), m_cmd(cmd), m_scope(profiler.begin_scope(cmd, name)) {}
+    ~GpuScope() { m_profiler.end_scope(m_cmd, m_scope); }
+
+private:
+    GpuProfiler &m_profiler;
+    VkCommandBuffer m_cmd;
+    uint32_t m_scope;
+};
+
+#define GPU_SCOPE_CONCAT_INDIRECT(x, y) x##y
+#define GPU_SCOPE_CONCAT(x, y) GPU_SCOPE_CONCAT_INDIRECT(x, y)
+
+// the tracy zone is only active when the profiler created a tracy context (timestamps supported)
+#define GpuZoneScopedN(profiler, cmd, name)                                                         \
+    TracyVkNamedZone((profiler).tracy_context(), GPU_SCOPE_CONCAT(__tracy_gpu_zone, __LINE__), cmd, \
+                     name, (profiler).tracy_context() != nullptr);                                  \
+    GpuScope GPU_SCOPE_CONCAT(__gpu_scope, __LINE__)(profiler, cmd, name)
@@ -0,0 +1,629 @@
+#include "vk_render_graph.h"
+#include "vk_initializers.h"
+#include "vk_profiler.h"
+#include "vk_parallel_recorder.h"
+
+#include <algorithm>
+
+const RenderGraph::UsageInfo &RenderGraph::usage_info(Usage usage)
+{
+    static const UsageInfo infos[(size_t)Usage::Count] = {
+        // ComputeRead
+        {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, true, false},
+        // ComputeWrite
+        {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, false, true},
+        // ComputeReadWrite
+        {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true, true},
+        // CopySrc
+        {VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, false},
+        // CopyDst
+        {VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false, true},
+        // Clear
+        {VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, false, true},
+        // ComputeSampled
+        {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false},
+        // FragmentSampled
+        {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false},
+        // BlitSrc
+        {VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, false},
+        // BlitDst
+        {VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false, true},
+        // ColorAttachment
+        {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, true},
+        // DepthAttachment
+        {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+         VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true, true},
+        // Present, the semaphore signal covers the execution dependency
+        {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true, false},
+        // IndirectRead
+        {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true, false},
+        // VertexRead
+        {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true, false},
+    };
+    return infos[(size_t)usage];
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::read(Resource resource, Usage usage)
+{
+    m_graph.add_use(m_pass, resource, usage, false);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::write(Resource resource, Usage usage)
+{
+    m_graph.add_use(m_pass, resource, usage, true);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::side_effect()
+{
+    m_graph.m_passes[m_pass].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::parallel()
+{
+    m_graph.m_passes[m_pass].parallel = true;
+    return *this;
+}
+
+void RenderGraph::set_parallel_recorder(ParallelRecorder *recorder, ExecuteFunction &&setup)
+{
+    m_recorder = recorder;
+    m_secondarySetup = std::move(setup);
+}
+
+void RenderGraph::begin(uint32_t queueFamily)
+{
+    m_queueFamily = queueFamily;
+    m_barriers.set_queue_family(queueFamily);
+    m_resources.clear();
+    m_passes.clear();
+}
+
+RenderGraph::Resource RenderGraph::import_image(const char *name, VkImage image, const ImportInfo &info, VkImageAspectFlags aspect)
+{
+    ResourceEntry entry{};
+    entry.name = name;
+    entry.image = image;
+    entry.aspect = aspect;
+    entry.initial.layout = info.layout;
+    entry.initial.queueFamily = info.queueFamily;
+    entry.initial.writeStage = info.stage;
+    entry.initial.writeAccess = info.access;
+    m_resources.push_back(entry);
+    return Resource(m_resources.size() - 1);
+}
+
+RenderGraph::ResourceState RenderGraph::from_image_state(const ImageState &image)
+{
+    ResourceState state{};
+    state.layout = image.layout;
+    state.queueFamily = image.queueFamily;
+    state.writeStage = image.stage;
+    if (image.access & kWriteAccessMask)
+    {
+        state.writeAccess = image.access;
+    }
+    else
+    {
+        // the last write is visible to the readers, later uses chain onto them
+        state.readStages = image.stage;
+        state.visibleStages = image.stage;
+        state.visibleAccess = image.access;
+    }
+    return state;
+}
+
+ImageState RenderGraph::to_image_state(const ResourceState &state)
+{
+    ImageState image{};
+    image.layout = state.layout;
+    image.queueFamily = state.queueFamily;
+    image.stage = state.writeStage | state.readStages;
+    image.access = state.writeAccess != VK_ACCESS_2_NONE ? state.writeAccess : state.visibleAccess;
+    return image;
+}
+
+RenderGraph::Resource RenderGraph::import_image(const char *name, VkImage image, ImageState &state, VkImageAspectFlags aspect)
+{
+    ResourceEntry entry{};
+    entry.name = name;
+    entry.image = image;
+    entry.aspect = aspect;
+    entry.initial = from_image_state(state);
+    entry.tracked = &state;
+    m_resources.push_back(entry);
+    return Resource(m_resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::import_image(const char *name, AllocatedImage &image)
+{
+    VkImageAspectFlags aspect = image.imageFormat == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    return import_image(name, image.image, image.state, aspect);
+}
+
+void RenderGraph::discard(Resource resource, VkPipelineStageFlags2 waitStage)
+{
+    ResourceState &initial = m_resources[resource].initial;
+    initial.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    initial.queueFamily = VK_QUEUE_FAMILY_IGNORED;
+    if (waitStage != VK_PIPELINE_STAGE_2_NONE)
+    {
+        initial = {};
+        initial.writeStage = waitStage;
+    }
+}
+
+RenderGraph::Resource RenderGraph::import_buffer(const char *name, VkBuffer buffer, const ImportInfo &info)
+{
+    ResourceEntry entry{};
+    entry.name = name;
+    entry.buffer = buffer;
+    entry.initial.queueFamily = info.queueFamily;
+    entry.initial.writeStage = info.stage;
+    entry.initial.writeAccess = info.access;
+    m_resources.push_back(entry);
+    return Resource(m_resources.size() - 1);
+}
+
+void RenderGraph::export_resource(Resource resource, Usage finalUsage, uint32_t queueFamily)
+{
+    ResourceEntry &entry = m_resources[resource];
+    entry.exported = true;
+    entry.finalUsage = finalUsage;
+    entry.finalQueueFamily = queueFamily;
+}
+
+RenderGraph::PassBuilder RenderGraph::add_pass(const char *name, ExecuteFunction &&execute)
+{
+    Pass &pass = m_passes.emplace_back();
+    pass.name = name;
+    pass.execute = std::move(execute);
+    return PassBuilder(*this, uint32_t(m_passes.size() - 1));
+}
+
+void RenderGraph::add_use(uint32_t passIndex, Resource resource, Usage usage, bool declaredWrite)
+{
+    Pass &pass = m_passes[passIndex];
+    const UsageInfo &info = usage_info(usage);
+    if (info.write != declaredWrite)
+    {
+        spdlog::error("RenderGraph: pass {} declares {} as {}, the usage says otherwise", pass.name,
+                      m_resources[resource].name, declaredWrite ? "write" : "read");
+    }
+
+    ResourceUse use{};
+    use.resource = resource;
+    use.stage = info.stage;
+    use.access = info.access;
+    use.layout = m_resources[resource].image != VK_NULL_HANDLE ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+    use.read = info.read;
+    use.write = info.write;
+
+    // one use per resource and pass, several usages of the same layout merge
+    for (auto &existing : pass.uses)
+    {
+        if (existing.resource != resource)
+        {
+            continue;
+        }
+        if (existing.layout != use.layout)
+        {
+            spdlog::error("RenderGraph: pass {} uses {} in two layouts", pass.name, m_resources[resource].name);
+        }
+        existing.stage |= use.stage;
+        existing.access |= use.access;
+        existing.read |= use.read;
+        existing.write |= use.write;
+        return;
+    }
+    pass.uses.push_back(use);
+}
+
+void RenderGraph::build_dependencies()
+{
+    constexpr uint32_t NONE = ~0u;
+    struct Tracking
+    {
+        uint32_t dataWriter{NONE}; // last pass that wrote the contents
+        uint32_t lastBarrier{NONE}; // last pass that wrote or changed the layout
+        std::vector<uint32_t> readers; // since lastBarrier
+        VkImageLayout layout;
+    };
+    std::vector<Tracking> tracking(m_resources.size());
+    for (size_t i = 0; i < m_resources.size(); i++)
+    {
+        tracking[i].layout = m_resources[i].initial.layout;
+    }
+
+    auto add_dependency = [](std::vector<uint32_t> &list, uint32_t pass)
+    {
+        if (pass != ~0u && std::find(list.begin(), list.end(), pass) == list.end())
+        {
+            list.push_back(pass);
+        }
+    };
+
+    for (uint32_t p = 0; p < m_passes.size(); p++)
+    {
+        Pass &pass = m_passes[p];
+        for (const auto &use : pass.uses)
+        {
+            Tracking &track = tracking[use.resource];
+            bool image = m_resources[use.resource].image != VK_NULL_HANDLE;
+            // a layout transition is a write as far as ordering goes
+            bool orderingWrite = use.write || (image && use.layout != track.layout);
+
+            if (use.read)
+            {
+                add_dependency(pass.dataDependencies, track.dataWriter);
+                add_dependency(pass.dependencies, track.dataWriter);
+            }
+            add_dependency(pass.dependencies, track.lastBarrier);
+
+            if (orderingWrite)
+            {
+                // write after read
+                for (uint32_t reader : track.readers)
+                {
+                    if (reader != p)
+                    {
+                        add_dependency(pass.dependencies, reader);
+                    }
+                }
+                track.readers.clear();
+                track.lastBarrier = p;
+                track.layout = image ? use.layout : track.layout;
+                if (use.write)
+                {
+                    track.dataWriter = p;
+                }
+            }
+            if (!use.write)
+            {
+                track.readers.push_back(p);
+            }
+        }
+    }
+}
+
+void RenderGraph::cull()
+{
+    for (auto &pass : m_passes)
+    {
+        pass.alive = pass.sideEffect;
+    }
+
+    // the last writer of an exported resource produces the graph's output
+    for (size_t r = 0; r < m_resources.size(); r++)
+    {
+        if (!m_resources[r].exported)
+        {
+            continue;
+        }
+        for (size_t p = m_passes.size(); p-- > 0;)
+        {
+            auto &uses = m_passes[p].uses;
+            if (std::any_of(uses.begin(), uses.end(), [r](const ResourceUse &use)
+                            { return use.resource == r && use.write; }))
+            {
+                m_passes[p].alive = true;
+                break;
+            }
+        }
+    }
+
+    // dependencies always point backwards, one reverse sweep reaches every producer
+    for (size_t p = m_passes.size(); p-- > 0;)
+    {
+        if (m_passes[p].alive)
+        {
+            for (uint32_t dependency : m_passes[p].dataDependencies)
+            {
+                m_passes[dependency].alive = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::transition(const ResourceEntry &entry, ResourceState &state, const ResourceUse &use, uint32_t dstQueueFamily)
+{
+    const bool image = entry.image != VK_NULL_HANDLE;
+    const bool acquire = state.queueFamily != VK_QUEUE_FAMILY_IGNORED && state.queueFamily != m_queueFamily;
+    const bool release = dstQueueFamily != VK_QUEUE_FAMILY_IGNORED && dstQueueFamily != m_queueFamily;
+    const bool layoutChange = image && state.layout != use.layout;
+
+    VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 dstStage = release ? VK_PIPELINE_STAGE_2_NONE : use.stage;
+    VkAccessFlags2 dstAccess = release ? VK_ACCESS_2_NONE : use.access;
+    bool needed = false;
+
+    if (acquire)
+    {
+        // the release and the semaphore wait already ordered the other queue's work,
+        // the layouts have to match the ones of the release
+        srcStage = use.stage;
+        needed = true;
+    }
+    else if (use.write || layoutChange || release)
+    {
+        // wait for the last write and every read since, flush the write
+        srcStage = state.writeStage | state.readStages;
+        srcAccess = state.writeAccess;
+        needed = layoutChange || release || srcStage != VK_PIPELINE_STAGE_2_NONE;
+    }
+    else if (state.writeStage != VK_PIPELINE_STAGE_2_NONE)
+    {
+        // read after write, unless an earlier barrier already made the write visible to this use
+        srcStage = state.writeStage;
+        srcAccess = state.writeAccess;
+        needed = (use.stage & ~state.visibleStages) != 0 || (use.access & ~state.visibleAccess) != 0;
+    }
+
+    if (needed)
+    {
+        uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED;
+        if (acquire)
+        {
+            srcFamily = state.queueFamily;
+            dstFamily = m_queueFamily;
+        }
+        else if (release)
+        {
+            srcFamily = m_queueFamily;
+            dstFamily = dstQueueFamily;
+        }
+
+        if (image)
+        {
+            VkImageMemoryBarrier2 barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            barrier.srcStageMask = srcStage;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstStageMask = dstStage;
+            barrier.dstAccessMask = dstAccess;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = use.layout;
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.image = entry.image;
+            barrier.subresourceRange = vkinit::image_subresource_range(entry.aspect);
+            m_barriers.add(barrier);
+        }
+        else
+        {
+            VkBufferMemoryBarrier2 barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+            barrier.srcStageMask = srcStage;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstStageMask = dstStage;
+            barrier.dstAccessMask = dstAccess;
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.buffer = entry.buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            m_barriers.add(barrier);
+        }
+    }
+
+    if (release)
+    {
+        // the acquiring side repeats this barrier, it needs the layout the release started from
+        VkImageLayout releasedLayout = state.layout;
+        state = {};
+        state.layout = releasedLayout;
+        state.queueFamily = m_queueFamily;
+        return;
+    }
+    state.queueFamily = VK_QUEUE_FAMILY_IGNORED;
+    if (use.write || layoutChange || acquire)
+    {
+        // the barrier made the transition visible to this use, a new write is visible to nobody yet
+        state.writeStage = use.stage;
+        state.writeAccess = use.write ? use.access : VK_ACCESS_2_NONE;
+        state.readStages = use.write ? VK_PIPELINE_STAGE_2_NONE : use.stage;
+        state.visibleStages = use.write ? VK_PIPELINE_STAGE_2_NONE : use.stage;
+        state.visibleAccess = use.write ? VK_ACCESS_2_NONE : use.access;
+    }
+    else
+    {
+        state.readStages |= use.stage;
+        if (needed)
+        {
+            state.visibleStages |= use.stage;
+            state.visibleAccess |= use.access;
+        }
+    }
+    if (image)
+    {
+        state.layout = use.layout;
+    }
+}
+
+void RenderGraph::flush_barriers(VkCommandBuffer cmd)
+{
+    if (m_barriers.flush(cmd))
+    {
+        m_barrierBatches++;
+    }
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, GpuProfiler *profiler)
+{
+    ZoneScoped;
+    build_dependencies();
+    cull();
+
+    // dependency level = longest chain of dependencies in front of the pass. culled passes count too:
+    // a read before a culled writer and a write after it still have to be ordered (war / waw through
+    // the culled pass), the chain through it keeps them in different levels
+    m_order.clear();
+    m_culledPasses = 0;
+    for (uint32_t p = 0; p < m_passes.size(); p++)
+    {
+        Pass &pass = m_passes[p];
+        pass.level = 0;
+        for (uint32_t dependency : pass.dependencies)
+        {
+            pass.level = std::max(pass.level, m_passes[dependency].level + 1);
+        }
+        if (!pass.alive)
+        {
+            m_culledPasses++;
+            continue;
+        }
+        m_order.push_back(p);
+    }
+    // independent passes end up next to each other, declaration order breaks ties
+    std::stable_sort(m_order.begin(), m_order.end(), [this](uint32_t a, uint32_t b)
+                     { return m_passes[a].level < m_passes[b].level; });
+
+    m_states.resize(m_resources.size());
+    for (size_t r = 0; r < m_resources.size(); r++)
+    {
+        m_states[r] = m_resources[r].initial;
+    }
+    m_levelUseIndex.assign(m_resources.size(), ~0u);
+    m_barrierBatches = 0;
+    m_parallelPassCount = 0;
+
+    size_t levelBegin = 0;
+    while (levelBegin < m_order.size())
+    {
+        uint32_t level = m_passes[m_order[levelBegin]].level;
+        size_t levelEnd = levelBegin;
+        while (levelEnd < m_order.size() && m_passes[m_order[levelEnd]].level == level)
+        {
+            levelEnd++;
+        }
+
+        // passes of one level only share resources for reading in the same layout, so their
+        // uses merge into one barrier per resource
+        m_levelUses.clear();
+        for (size_t i = levelBegin; i < levelEnd; i++)
+        {
+            for (const auto &use : m_passes[m_order[i]].uses)
+            {
+                uint32_t &index = m_levelUseIndex[use.resource];
+                if (index == ~0u)
+                {
+                    index = (uint32_t)m_levelUses.size();
+                    m_levelUses.push_back(use);
+                    continue;
+                }
+                ResourceUse &merged = m_levelUses[index];
+                merged.stage |= use.stage;
+                merged.access |= use.access;
+                merged.read |= use.read;
+                merged.write |= use.write;
+            }
+        }
+        for (const auto &use : m_levelUses)
+        {
+            transition(m_resources[use.resource], m_states[use.resource], use, VK_QUEUE_FAMILY_IGNORED);
+            m_levelUseIndex[use.resource] = ~0u;
+        }
+        flush_barriers(cmd);
+
+        // independent passes that allow it are recorded side by side, one secondary each.
+        // a single one is cheaper to record inline
+        m_parallelPasses.clear();
+        if (m_recorder)
+        {
+            for (size_t i = levelBegin; i < levelEnd; i++)
+            {
+                if (m_passes[m_order[i]].parallel)
+                {
+                    m_parallelPasses.push_back(m_order[i]);
+                }
+            }
+        }
+        if (m_parallelPasses.size() > 1)
+        {
+            m_secondaries.resize(m_parallelPasses.size());
+            m_secondaryIndex.assign(m_passes.size(), ~0u);
+            for (uint32_t s = 0; s < m_parallelPasses.size(); s++)
+            {
+                m_secondaryIndex[m_parallelPasses[s]] = s;
+            }
+            m_recorder->record(m_secondaries, {}, [this](VkCommandBuffer secondary, uint32_t index)
+                               {
+                                   if (m_secondarySetup)
+                                   {
+                                       m_secondarySetup(secondary);
+                                   }
+                                   m_passes[m_parallelPasses[index]].execute(secondary); });
+            m_parallelPassCount += (uint32_t)m_parallelPasses.size();
+        }
+        else
+        {
+            m_parallelPasses.clear();
+        }
+
+        for (size_t i = levelBegin; i < levelEnd; i++)
+        {
+            Pass &pass = m_passes[m_order[i]];
+            // the pass was recorded already, it only has to go into the primary at its place
+            bool recorded = !m_parallelPasses.empty() && m_secondaryIndex[m_order[i]] != ~0u;
+            auto run = [&]
+            {
+                if (recorded)
+                {
+                    vkCmdExecuteCommands(cmd, 1, &m_secondaries[m_secondaryIndex[m_order[i]]]);
+                    // bound state of the primary is undefined after executing secondaries
+                    if (m_secondarySetup)
+                    {
+                        m_secondarySetup(cmd);
+                    }
+                }
+                else
+                {
+                    pass.execute(cmd);
+                }
+            };
+            if (profiler)
+            {
+                TracyVkZoneTransient(profiler->tracy_context(), tracyZone, cmd, pass.name, profiler->tracy_context() != nullptr);
+                GpuScope scope(*profiler, cmd, pass.name);
+                run();
+            }
+            else
+            {
+                run();
+            }
+        }
+        levelBegin = levelEnd;
+    }
+
+    // final states of the exported resources, all in one batch
+    for (size_t r = 0; r < m_resources.size(); r++)
+    {
+        const ResourceEntry &entry = m_resources[r];
+        if (!entry.exported)
+        {
+            continue;
+        }
+        const UsageInfo &info = usage_info(entry.finalUsage);
+        ResourceUse use{};
+        use.resource = Resource(r);
+        use.stage = info.stage;
+        use.access = info.access;
+        use.layout = entry.image != VK_NULL_HANDLE ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        use.read = info.read;
+        use.write = info.write;
+        transition(entry, m_states[r], use, entry.finalQueueFamily);
+    }
+    flush_barriers(cmd);
+
+    for (size_t r = 0; r < m_resources.size(); r++)
+    {
+        if (m_resources[r].tracked)
+        {
+            *m_resources[r].tracked = to_image_state(m_states[r]);
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "vk_barriers.h"
+
+class GpuProfiler;
+class ParallelRecorder;
+
+// Per-frame render graph.
+// Passes declare how they use imported images / buffers, the graph derives the layouts and the
+// minimal stage / access masks between them instead of full ALL_COMMANDS barriers.
+// On execute() it
+//  - culls passes whose results nobody reads (roots: side effect passes and the last writer
+//    of every exported resource),
+//  - groups passes into dependency levels, passes of one level are independent and run
+//    back to back after a single merged barrier. with a ParallelRecorder, the parallel() passes
+//    of a level are recorded concurrently into secondary command buffers,
+//  - emits the final barriers of exported resources, including queue family releases,
+//  - writes the final state back into tracked images (ImageState).
+// The graph is rebuilt every frame: begin(), import, add passes, export, execute().
+class RenderGraph
+{
+public:
+    enum class Usage : uint8_t
+    {
+        // images and buffers
+        ComputeRead,      // storage image / buffer read in a compute shader
+        ComputeWrite,     // storage image / buffer written in a compute shader
+        ComputeReadWrite, // both, e.g. in place filters
+        CopySrc,
+        CopyDst,
+        Clear, // vkCmdClearColorImage in GENERAL layout, vkCmdFillBuffer on buffers
+        // images only
+        ComputeSampled,  // sampled image in a compute shader
+        FragmentSampled, // sampled image in a fragment shader
+        BlitSrc,
+        BlitDst,
+        ColorAttachment, // dynamic rendering color attachment, loaded and stored
+        DepthAttachment, // dynamic rendering depth attachment, tested and written
+        Present,         // only as export, swapchain image handed to the presentation engine
+        // buffers only
+        IndirectRead,
+        VertexRead, // storage buffer read in a vertex shader, e.g. vertex pulling
+        Count
+    };
+
+    using Resource = uint32_t;
+    static constexpr Resource INVALID_RESOURCE = ~0u;
+
+    // what happened to the resource before this graph. a queue family other than the graph's
+    // turns the first barrier into the acquire half of an ownership transfer
+    struct ImportInfo
+    {
+        VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        VkPipelineStageFlags2 stage{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 access{VK_ACCESS_2_NONE};
+        uint32_t queueFamily{VK_QUEUE_FAMILY_IGNORED};
+    };
+
+    class PassBuilder
+    {
+    public:
+        PassBuilder &read(Resource resource, Usage usage);
+        PassBuilder &write(Resource resource, Usage usage);
+        // never culled, e.g. readbacks or passes that only write outside the graph
+        PassBuilder &side_effect();
+        // execute may run on a recording thread, into a secondary command buffer that starts
+        // without bound state. it must not begin / end anything that spans other passes.
+        // only worth it for passes with many commands: a secondary, a job and vkCmdExecuteCommands
+        // cost more than recording a dispatch or a copy inline
+        PassBuilder &parallel();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph &graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+        RenderGraph &m_graph;
+        uint32_t m_pass;
+    };
+
+    using ExecuteFunction = std::function<void(VkCommandBuffer cmd)>;
+
+    // starts a new graph recorded for the given queue family, drops the previous one
+    void begin(uint32_t queueFamily);
+
+    // records parallel() passes of one level concurrently. setup runs first in every secondary,
+    // to bind what all passes expect (e.g. the bindless heap). nullptr = everything on the caller
+    void set_parallel_recorder(ParallelRecorder *recorder, ExecuteFunction &&setup = {});
+
+    // names have to outlive the frame (string literals), they end up in the gpu profiler
+    Resource import_image(const char *name, VkImage image, const ImportInfo &info = {}, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+    // tracked image: the graph starts from state and stores the state after the graph back into it
+    Resource import_image(const char *name, VkImage image, ImageState &state, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+    Resource import_image(const char *name, AllocatedImage &image);
+    Resource import_buffer(const char *name, VkBuffer buffer, const ImportInfo &info = {});
+    // the old contents are not needed: the first barrier starts from UNDEFINED and skips any acquire.
+    // waitStage replaces the previous stage when that use was outside this queue (other queue family,
+    // presentation engine), pass the stage the submission's semaphore wait covers
+    void discard(Resource resource, VkPipelineStageFlags2 waitStage = VK_PIPELINE_STAGE_2_NONE);
+    // state the resource has to be in after the graph. a queue family other than the graph's
+    // records the release half of an ownership transfer
+    void export_resource(Resource resource, Usage finalUsage, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+    PassBuilder add_pass(const char *name, ExecuteFunction &&execute);
+
+    // records the graph into cmd, every pass gets a gpu zone when a profiler is given
+    void execute(VkCommandBuffer cmd, GpuProfiler *profiler = nullptr);
+
+    // stats of the last execute()
+    uint32_t culled_passes() const { return m_culledPasses; }
+    uint32_t barrier_batches() const { return m_barrierBatches; }
+    uint32_t parallel_passes() const { return m_parallelPassCount; }
+
+private:
+    struct UsageInfo
+    {
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2 access;
+        VkImageLayout layout;
+        bool read;
+        bool write;
+    };
+    static const UsageInfo &usage_info(Usage usage);
+
+    struct ResourceState
+    {
+        VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        uint32_t queueFamily{VK_QUEUE_FAMILY_IGNORED};
+        // last write (or layout transition) and the reads that happened since
+        VkPipelineStageFlags2 writeStage{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 writeAccess{VK_ACCESS_2_NONE};
+        VkPipelineStageFlags2 readStages{VK_PIPELINE_STAGE_2_NONE};
+        // stages / accesses the last write is already visible to
+        VkPipelineStageFlags2 visibleStages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 visibleAccess{VK_ACCESS_2_NONE};
+    };
+
+    struct ResourceEntry
+    {
+        const char *name;
+        VkImage image{VK_NULL_HANDLE};
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VkImageAspectFlags aspect{0};
+        ResourceState initial;
+        ImageState *tracked{nullptr};
+        bool exported{false};
+        Usage finalUsage{Usage::Count};
+        uint32_t finalQueueFamily{VK_QUEUE_FAMILY_IGNORED};
+    };
+
+    struct ResourceUse
+    {
+        Resource resource;
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2 access;
+        VkImageLayout layout;
+        bool read;
+        bool write;
+    };
+
+    struct Pass
+    {
+        const char *name;
+        ExecuteFunction execute;
+        std::vector<ResourceUse> uses;
+        bool sideEffect{false};
+        bool parallel{false};
+        // filled by execute()
+        std::vector<uint32_t> dependencies;     // every pass that has to run before this one
+        std::vector<uint32_t> dataDependencies; // the subset whose results this pass consumes
+        bool alive{false};
+        uint32_t level{0};
+    };
+
+    void add_use(uint32_t pass, Resource resource, Usage usage, bool declaredWrite);
+    void build_dependencies();
+    void cull();
+    // appends the barrier that moves state to the given use, updates state
+    void transition(const ResourceEntry &entry, ResourceState &state, const ResourceUse &use, uint32_t dstQueueFamily);
+    void flush_barriers(VkCommandBuffer cmd);
+    static ResourceState from_image_state(const ImageState &state);
+    static ImageState to_image_state(const ResourceState &state);
+
+    uint32_t m_queueFamily{VK_QUEUE_FAMILY_IGNORED};
+    std::vector<ResourceEntry> m_resources;
+    std::vector<Pass> m_passes;
+
+    // scratch, kept between frames to avoid reallocations
+    std::vector<ResourceState> m_states;
+    BarrierBatcher m_barriers;
+    std::vector<uint32_t> m_order;
+    // uses of one dependency level merged per resource
+    std::vector<ResourceUse> m_levelUses;
+    std::vector<uint32_t> m_levelUseIndex;
+
+    ParallelRecorder *m_recorder{nullptr};
+    ExecuteFunction m_secondarySetup;
+    // passes of the current level recorded into secondaries, and the secondaries per pass
+    std::vector<uint32_t> m_parallelPasses;
+    std::vector<VkCommandBuffer> m_secondaries;
+    std::vector<uint32_t> m_secondaryIndex;
+
+    uint32_t m_culledPasses{0};
+    uint32_t m_barrierBatches{0};
+    uint32_t m_parallelPassCount{0};
+};
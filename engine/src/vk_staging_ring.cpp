@@ -0,0 +1,149 @@
+#include "vk_staging_ring.h"
+#include "vk_initializers.h"
+
+#include <algorithm>
+#include <cstring>
+
+void StagingRing::init(const InitInfo &info)
+{
+    ZoneScoped;
+    m_device = info.device;
+    m_allocator = info.allocator;
+    m_timeline = info.timeline;
+    m_minAlignment = info.minAlignment;
+    m_usage = info.usage;
+    m_slotSize = info.slotSize;
+
+    m_slots.resize(info.frameSlots);
+    for (auto &slot : m_slots)
+    {
+        create_slot_buffer(slot, info.slotSize);
+    }
+    spdlog::info("StagingRing: {} slots of {} KiB", info.frameSlots, info.slotSize / 1024);
+}
+
+void StagingRing::destroy()
+{
+    for (auto &slot : m_slots)
+    {
+        vkutil::destroy_buffer(m_allocator, slot.buffer);
+        for (auto &buffer : slot.overflow)
+        {
+            vkutil::destroy_buffer(m_allocator, buffer);
+        }
+    }
+    m_slots.clear();
+}
+
+void StagingRing::resize(uint32_t frameSlots)
+{
+    ZoneScoped;
+    for (size_t i = frameSlots; i < m_slots.size(); i++)
+    {
+        vkutil::destroy_buffer(m_allocator, m_slots[i].buffer);
+        for (auto &buffer : m_slots[i].overflow)
+        {
+            vkutil::destroy_buffer(m_allocator, buffer);
+        }
+    }
+    size_t first = m_slots.size();
+    m_slots.resize(frameSlots);
+    // new slots start at the initial size, they grow like the others when a frame needs more
+    for (size_t i = first; i < m_slots.size(); i++)
+    {
+        create_slot_buffer(m_slots[i], m_slotSize);
+    }
+    m_current = 0;
+    spdlog::info("StagingRing: {} slots", frameSlots);
+}
+
+void StagingRing::create_slot_buffer(Slot &slot, VkDeviceSize size)
+{
+    slot.buffer = vkutil::create_buffer(m_allocator, size, m_usage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    slot.size = size;
+    slot.offset = 0;
+}
+
+void StagingRing::begin_frame(uint32_t frameSlot)
+{
+    ZoneScoped;
+    m_current = frameSlot;
+    Slot &slot = m_slots[frameSlot];
+
+    // normally already reached, draw() waited on the slot's frame before
+    VK_CHECK(m_timeline->wait(slot.retireValue));
+
+    for (auto &buffer : slot.overflow)
+    {
+        vkutil::destroy_buffer(m_allocator, buffer);
+    }
+    slot.overflow.clear();
+
+    // the slot was too small last time around, grow it now that the gpu is done with it
+    if (slot.overflowBytes > 0)
+    {
+        VkDeviceSize newSize = get_aligned(std::max(slot.size * 2, slot.offset + slot.overflowBytes), m_minAlignment);
+        spdlog::info("StagingRing: slot {} grows from {} KiB to {} KiB", frameSlot, slot.size / 1024, newSize / 1024);
+        vkutil::destroy_buffer(m_allocator, slot.buffer);
+        create_slot_buffer(slot, newSize);
+        slot.overflowBytes = 0;
+    }
+    slot.offset = 0;
+}
+
+void StagingRing::end_frame(uint64_t retireValue)
+{
+    Slot &slot = m_slots[m_current];
+    // no-op on host coherent memory
+    if (slot.offset > 0)
+    {
+        VK_CHECK(vmaFlushAllocation(m_allocator, slot.buffer.allocation, 0, slot.offset));
+    }
+    for (auto &buffer : slot.overflow)
+    {
+        VK_CHECK(vmaFlushAllocation(m_allocator, buffer.allocation, 0, VK_WHOLE_SIZE));
+    }
+    slot.retireValue = retireValue;
+}
+
+StagingRing::Allocation StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    Slot &slot = m_slots[m_current];
+    VkDeviceSize align = std::max(alignment, m_minAlignment);
+    VkDeviceSize offset = get_aligned(slot.offset, align);
+
+    Allocation allocation{};
+    allocation.size = size;
+    if (offset + size <= slot.size)
+    {
+        allocation.buffer = slot.buffer.buffer;
+        allocation.offset = offset;
+        allocation.mapped = (char *)slot.buffer.info.pMappedData + offset;
+        slot.offset = offset + size;
+        return allocation;
+    }
+
+    // does not fit: dedicated buffer for this request, the slot grows on its next begin_frame()
+    ZoneScopedN("StagingRing overflow");
+    AllocatedBuffer buffer = vkutil::create_buffer(m_allocator, size, m_usage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    slot.overflow.push_back(buffer);
+    slot.overflowBytes += get_aligned(size, align);
+
+    allocation.buffer = buffer.buffer;
+    allocation.offset = 0;
+    allocation.mapped = buffer.info.pMappedData;
+    return allocation;
+}
+
+StagingRing::Allocation StagingRing::push(const void *data, VkDeviceSize size, VkDeviceSize alignment)
+{
+    Allocation allocation = allocate(size, alignment);
+    std::memcpy(allocation.mapped, data, size);
+    return allocation;
+}
+
+VkDeviceSize StagingRing::used() const
+{
+    const Slot &slot = m_slots[m_current];
+    return slot.offset + slot.overflowBytes;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "vk_timeline.h"
+
+// Persistently mapped per-frame staging memory.
+// Every frame slot owns one host visible buffer that is bump allocated while the frame is recorded
+// and rewound once the slot's timeline value retired, so per-frame uniforms and small uploads never
+// touch vmaCreateBuffer. A request that does not fit the slot gets an overflow buffer that lives
+// until the slot retires; a slot that overflowed grows before its next use.
+class StagingRing
+{
+public:
+    struct InitInfo
+    {
+        VkDevice device;
+        VmaAllocator allocator;
+        // timeline the frame submissions signal, end_frame() receives their values
+        GpuTimeline *timeline;
+        uint32_t frameSlots;
+        VkDeviceSize slotSize{1024 * 1024};
+        // smallest offset alignment every allocation gets (uniform / storage / copy offset limits)
+        VkDeviceSize minAlignment{16};
+        VkBufferUsageFlags usage{VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    };
+
+    struct Allocation
+    {
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VkDeviceSize offset{0};
+        VkDeviceSize size{0};
+        void *mapped{nullptr};
+    };
+
+    void init(const InitInfo &info);
+    void destroy();
+    // changes the number of frame slots. only while no frame is in flight (after a device wait)
+    void resize(uint32_t frameSlots);
+
+    // rewinds the slot, waiting for its previous frame if that did not retire yet
+    void begin_frame(uint32_t frameSlot);
+    // flushes the written range and tags the slot with the timeline value of the frame's submission
+    void end_frame(uint64_t retireValue);
+
+    // alignment 0 = minAlignment. valid until the slot's frame retired
+    Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+    // allocate + memcpy
+    Allocation push(const void *data, VkDeviceSize size, VkDeviceSize alignment = 0);
+
+    // bytes handed out in the current frame, including overflow
+    VkDeviceSize used() const;
+
+private:
+    struct Slot
+    {
+        AllocatedBuffer buffer{};
+        VkDeviceSize size{0};
+        VkDeviceSize offset{0};
+        // buffers for requests that did not fit, destroyed when the slot retires
+        std::vector<AllocatedBuffer> overflow;
+        VkDeviceSize overflowBytes{0};
+        uint64_t retireValue{0};
+    };
+
+    void create_slot_buffer(Slot &slot, VkDeviceSize size);
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    VmaAllocator m_allocator{VK_NULL_HANDLE};
+    GpuTimeline *m_timeline{nullptr};
+    VkDeviceSize m_minAlignment{16};
+    VkBufferUsageFlags m_usage{0};
+    VkDeviceSize m_slotSize{0};
+
+    std::vector<Slot> m_slots;
+    uint32_t m_current{0};
+};
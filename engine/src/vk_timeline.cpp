@@ -0,0 +1,75 @@
+#include "vk_timeline.h"
+#include "vk_initializers.h"
+
+void GpuTimeline::init(VkDevice device, uint64_t initialValue)
+{
+    m_device = device;
+
+    VkSemaphoreTypeCreateInfo typeInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphore_create_info();
+    semaphoreCreateInfo.pNext = &typeInfo;
+
+    VK_CHECK(vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_semaphore));
+    m_lastSubmitted = initialValue;
+    m_completed = initialValue;
+}
+
+void GpuTimeline::destroy()
+{
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+    m_semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t GpuTimeline::completed_value()
+{
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_semaphore, &value));
+    m_completed = value;
+    return value;
+}
+
+bool GpuTimeline::is_complete(uint64_t value)
+{
+    if (value <= m_completed)
+    {
+        return true;
+    }
+    return value <= completed_value();
+}
+
+VkResult GpuTimeline::wait(uint64_t value, uint64_t timeoutNs)
+{
+    if (value <= m_completed)
+    {
+        return VK_SUCCESS;
+    }
+    ZoneScoped;
+    VkSemaphoreWaitInfo waitInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+
+    VkResult result = vkWaitSemaphores(m_device, &waitInfo, timeoutNs);
+    if (result == VK_SUCCESS)
+    {
+        // another thread may already have observed a higher value
+        uint64_t completed = m_completed;
+        while (completed < value && !m_completed.compare_exchange_weak(completed, value))
+        {
+        }
+    }
+    return result;
+}
+
+VkSemaphoreSubmitInfo GpuTimeline::signal_info(uint64_t value, VkPipelineStageFlags2 stageMask) const
+{
+    return vkinit::semaphore_submit_info(stageMask, m_semaphore, value);
+}
+
+VkSemaphoreSubmitInfo GpuTimeline::wait_info(uint64_t value, VkPipelineStageFlags2 stageMask) const
+{
+    return vkinit::semaphore_submit_info(stageMask, m_semaphore, value);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "engine/vk_types.h"
+
+#include <atomic>
+
+// Device timeline semaphore (Vulkan 1.2 core).
+// Every submission signals the next value, so cpu waits, cross-queue dependencies
+// and deferred deletion all key off one monotonically increasing counter.
+// Values have to be signaled in increasing order: submissions that signal the same
+// timeline must either go to the same queue or wait on the previous value.
+class GpuTimeline
+{
+public:
+    void init(VkDevice device, uint64_t initialValue = 0);
+    void destroy();
+
+    VkSemaphore semaphore() const { return m_semaphore; }
+
+    // reserves the value the next submission signals, call right before vkQueueSubmit2
+    uint64_t next_value() { return ++m_lastSubmitted; }
+    uint64_t last_submitted() const { return m_lastSubmitted; }
+
+    // highest value the gpu reached, refreshed from the driver
+    uint64_t completed_value();
+    // cheap check against the cached completed value, only queries the driver when needed
+    bool is_complete(uint64_t value);
+    // blocks until the gpu reached value, returns VK_TIMEOUT when timeoutNs elapsed first
+    VkResult wait(uint64_t value, uint64_t timeoutNs = UINT64_MAX);
+
+    VkSemaphoreSubmitInfo signal_info(uint64_t value, VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) const;
+    VkSemaphoreSubmitInfo wait_info(uint64_t value, VkPipelineStageFlags2 stageMask) const;
+
+private:
+    VkDevice m_device{VK_NULL_HANDLE};
+    VkSemaphore m_semaphore{VK_NULL_HANDLE};
+    std::atomic<uint64_t> m_lastSubmitted{0};
+    std::atomic<uint64_t> m_completed{0};
+};
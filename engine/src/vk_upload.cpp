@@ -0,0 +1,289 @@
+#include "vk_upload.h"
+#include "vk_initializers.h"
+
+#include <cstring>
+
+// copy offsets into the staging buffer, covers every texel size of the formats we upload
+static constexpr VkDeviceSize kStagingAlignment = 16;
+
+void UploadContext::init(const InitInfo &info)
+{
+    ZoneScoped;
+    m_device = info.device;
+    m_allocator = info.allocator;
+    m_queue = info.queue;
+    m_queueFamily = info.queueFamily;
+    m_graphicsQueueFamily = info.graphicsQueueFamily;
+    m_families = {m_queueFamily, m_graphicsQueueFamily};
+    m_uploadBarriers.set_queue_family(m_queueFamily);
+    m_acquireBarriers.set_queue_family(m_graphicsQueueFamily);
+    m_blockSize = info.stagingBlockSize;
+
+    m_timeline.init(m_device);
+
+    spdlog::info("UploadContext: uploads on queue family {}{}", m_queueFamily, separate_queue() ? " (dedicated transfer)" : "");
+}
+
+void UploadContext::destroy()
+{
+    std::lock_guard lock(m_mutex);
+    if (m_device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    VK_CHECK(m_timeline.wait(m_timeline.last_submitted()));
+
+    auto destroyBatch = [&](Batch &batch)
+    {
+        for (auto &block : batch.staging)
+        {
+            vkutil::destroy_buffer(m_allocator, block.buffer);
+        }
+        vkDestroyCommandPool(m_device, batch.pool, nullptr);
+    };
+    // an open batch that never got flushed is simply dropped
+    destroyBatch(m_open);
+    for (auto &batch : m_inFlight)
+    {
+        destroyBatch(batch);
+    }
+    for (auto &batch : m_freeBatches)
+    {
+        destroyBatch(batch);
+    }
+    for (auto &block : m_freeBlocks)
+    {
+        vkutil::destroy_buffer(m_allocator, block.buffer);
+    }
+    m_open = {};
+    m_inFlight.clear();
+    m_freeBatches.clear();
+    m_freeBlocks.clear();
+    m_pendingAcquires.clear();
+
+    m_timeline.destroy();
+    m_device = VK_NULL_HANDLE;
+}
+
+UploadContext::Batch &UploadContext::open_batch()
+{
+    if (m_open.recording)
+    {
+        return m_open;
+    }
+
+    if (!m_freeBatches.empty())
+    {
+        m_open = std::move(m_freeBatches.back());
+        m_freeBatches.pop_back();
+    }
+    else
+    {
+        VkCommandPoolCreateInfo poolInfo = vkinit::command_pool_create_info(m_queueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        VK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_open.pool));
+
+        VkCommandBufferAllocateInfo cmdAllocInfo = vkinit::command_buffer_allocate_info(m_open.pool, 1);
+        VK_CHECK(vkAllocateCommandBuffers(m_device, &cmdAllocInfo, &m_open.cmd));
+    }
+
+    VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(m_open.cmd, &cmdBeginInfo));
+    m_open.recording = true;
+    return m_open;
+}
+
+UploadContext::StagingBlock UploadContext::create_block(VkDeviceSize size)
+{
+    StagingBlock block{};
+    block.buffer = vkutil::create_buffer(m_allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+    block.size = size;
+    return block;
+}
+
+void UploadContext::release_block(StagingBlock &block)
+{
+    // oversize blocks were made for one request, only the standard size is recycled
+    if (block.size != m_blockSize)
+    {
+        vkutil::destroy_buffer(m_allocator, block.buffer);
+        return;
+    }
+    block.offset = 0;
+    m_freeBlocks.push_back(block);
+}
+
+UploadContext::StagingBlock &UploadContext::stage(Batch &batch, const void *data, VkDeviceSize size, VkDeviceSize &offset)
+{
+    StagingBlock *block = batch.staging.empty() ? nullptr : &batch.staging.back();
+    if (block && block->size == m_blockSize && get_aligned(block->offset, kStagingAlignment) + size <= block->size)
+    {
+        offset = get_aligned(block->offset, kStagingAlignment);
+    }
+    else
+    {
+        if (size > m_blockSize)
+        {
+            batch.staging.push_back(create_block(size));
+        }
+        else if (!m_freeBlocks.empty())
+        {
+            batch.staging.push_back(m_freeBlocks.back());
+            m_freeBlocks.pop_back();
+        }
+        else
+        {
+            batch.staging.push_back(create_block(m_blockSize));
+        }
+        block = &batch.staging.back();
+        offset = 0;
+    }
+
+    std::memcpy((char *)block->buffer.info.pMappedData + offset, data, size);
+    block->offset = offset + size;
+    return *block;
+}
+
+UploadTicket UploadContext::upload_buffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size, bool concurrent)
+{
+    ZoneScoped;
+    std::lock_guard lock(m_mutex);
+    Batch &batch = open_batch();
+
+    VkDeviceSize srcOffset = 0;
+    StagingBlock &block = stage(batch, data, size, srcOffset);
+
+    VkBufferCopy copy{};
+    copy.srcOffset = srcOffset;
+    copy.dstOffset = dstOffset;
+    copy.size = size;
+    vkCmdCopyBuffer(batch.cmd, block.buffer.buffer, dst, 1, &copy);
+
+    // a concurrent buffer only needs the frame's wait on the upload timeline
+    if (separate_queue() && !concurrent)
+    {
+        // release half, record_acquires() does the other one
+        vkutil::buffer_barrier(batch.cmd, dst, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, m_queueFamily, m_graphicsQueueFamily);
+        batch.acquires.push_back({.buffer = dst});
+    }
+
+    // the open batch signals the value after the last submitted one
+    return {m_timeline.last_submitted() + 1};
+}
+
+UploadTicket UploadContext::upload_image(AllocatedImage &dst, const void *data, VkDeviceSize size, VkImageLayout finalLayout)
+{
+    ZoneScoped;
+    std::lock_guard lock(m_mutex);
+    Batch &batch = open_batch();
+
+    VkDeviceSize srcOffset = 0;
+    StagingBlock &block = stage(batch, data, size, srcOffset);
+
+    // the old contents are overwritten, no need to wait for or acquire them
+    m_uploadBarriers.image(dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, true);
+    m_uploadBarriers.flush(batch.cmd);
+
+    VkBufferImageCopy copyRegion = {};
+    copyRegion.bufferOffset = srcOffset;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.bufferImageHeight = 0;
+
+    copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copyRegion.imageSubresource.mipLevel = 0;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount = 1;
+    copyRegion.imageExtent = dst.imageExtent;
+
+    vkCmdCopyBufferToImage(batch.cmd, block.buffer.buffer, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+    if (separate_queue())
+    {
+        // release half including the layout change, record_acquires() does the acquire from the released state
+        m_uploadBarriers.release(dst.image, dst.state, finalLayout, m_graphicsQueueFamily);
+        batch.acquires.push_back({.image = dst.image, .layout = finalLayout, .state = dst.state});
+    }
+    else
+    {
+        // the frame waits on the upload timeline at all commands
+        m_uploadBarriers.image(dst, finalLayout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT);
+    }
+    m_uploadBarriers.flush(batch.cmd);
+
+    // uses recorded after the frame's acquire see the image in the state the acquire leaves behind
+    dst.state = {finalLayout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT};
+
+    return {m_timeline.last_submitted() + 1};
+}
+
+UploadTicket UploadContext::flush()
+{
+    std::lock_guard lock(m_mutex);
+    if (!m_open.recording)
+    {
+        return {m_timeline.last_submitted()};
+    }
+    ZoneScoped;
+
+    VK_CHECK(vkEndCommandBuffer(m_open.cmd));
+
+    VkCommandBufferSubmitInfo cmdinfo = vkinit::command_buffer_submit_info(m_open.cmd);
+    uint64_t value = m_timeline.next_value();
+    VkSemaphoreSubmitInfo signalInfo = m_timeline.signal_info(value);
+    VkSubmitInfo2 submit = vkinit::submit_info(&cmdinfo, &signalInfo, nullptr);
+    VK_CHECK(vkQueueSubmit2(m_queue, 1, &submit, VK_NULL_HANDLE));
+
+    m_open.value = value;
+    m_open.recording = false;
+    m_pendingAcquires.insert(m_pendingAcquires.end(), m_open.acquires.begin(), m_open.acquires.end());
+    m_open.acquires.clear();
+    m_pendingWait = value;
+
+    m_inFlight.push_back(std::move(m_open));
+    m_open = {};
+    return {value};
+}
+
+void UploadContext::collect()
+{
+    std::lock_guard lock(m_mutex);
+    while (!m_inFlight.empty() && m_timeline.is_complete(m_inFlight.front().value))
+    {
+        Batch &batch = m_inFlight.front();
+        VK_CHECK(vkResetCommandPool(m_device, batch.pool, 0));
+        for (auto &block : batch.staging)
+        {
+            release_block(block);
+        }
+        batch.staging.clear();
+        m_freeBatches.push_back(std::move(batch));
+        m_inFlight.pop_front();
+    }
+}
+
+uint64_t UploadContext::record_acquires(VkCommandBuffer cmd)
+{
+    std::lock_guard lock(m_mutex);
+    for (const Acquire &acquire : m_pendingAcquires)
+    {
+        // the frame waits on the upload timeline at all commands, chain the acquire to that wait
+        if (acquire.image != VK_NULL_HANDLE)
+        {
+            ImageState state = acquire.state;
+            m_acquireBarriers.image(acquire.image, state, acquire.layout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT);
+        }
+        else
+        {
+            m_acquireBarriers.buffer(acquire.buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE,
+                                     VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT,
+                                     m_queueFamily, m_graphicsQueueFamily);
+        }
+    }
+    m_acquireBarriers.flush(cmd);
+    m_pendingAcquires.clear();
+
+    // waiting on a value that was already reached costs the frame nothing
+    uint64_t wait = m_pendingWait;
+    m_pendingWait = 0;
+    return wait;
+}
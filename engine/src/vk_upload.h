@@ -0,0 +1,125 @@
+#pragma once
+
+#include "engine/vk_types.h"
+#include "vk_timeline.h"
+#include "vk_barriers.h"
+
+#include <mutex>
+
+// handle for an upload request. the data has arrived once the upload timeline reached value
+struct UploadTicket
+{
+    uint64_t value{0};
+};
+
+// Non-blocking cpu -> gpu uploads.
+// Copy requests are staged into persistently mapped host memory and recorded into the
+// open batch; flush() submits the batch on the transfer queue and signals the upload timeline.
+// Nothing blocks unless the caller waits on a ticket. Finished batches hand their command pool
+// and staging blocks back for reuse.
+// With a separate transfer family the resources are released to the graphics family;
+// record_acquires() records the matching acquire barriers into the next frame.
+class UploadContext
+{
+public:
+    struct InitInfo
+    {
+        VkDevice device;
+        VmaAllocator allocator;
+        VkQueue queue;
+        uint32_t queueFamily;
+        // family the uploaded resources are used on
+        uint32_t graphicsQueueFamily;
+        // size of a recycled staging block, larger requests get a dedicated one
+        VkDeviceSize stagingBlockSize{8 * 1024 * 1024};
+    };
+
+    void init(const InitInfo &info);
+    void destroy();
+
+    // copies data into staging now and records the copy into the open batch.
+    // the ticket completes with the batch, after the next flush().
+    // concurrent: dst was created for shared_families(), it needs no ownership transfer
+    UploadTicket upload_buffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size, bool concurrent = false);
+    // whole image, mip 0 / layer 0. the image ends up in finalLayout, its tracked state is set to
+    // what frames recorded after the next flush() see
+    UploadTicket upload_image(AllocatedImage &dst, const void *data, VkDeviceSize size,
+                              VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // submits the open batch, returns its ticket (or the last submitted one when there was nothing to do)
+    UploadTicket flush();
+    // recycles command pools and staging of finished batches
+    void collect();
+
+    bool is_complete(UploadTicket ticket) { return m_timeline.is_complete(ticket.value); }
+    VkResult wait(UploadTicket ticket, uint64_t timeoutNs = UINT64_MAX) { return m_timeline.wait(ticket.value, timeoutNs); }
+
+    // graphics side: records the acquire half of the ownership transfers of every batch submitted since the
+    // last call and returns the upload timeline value the frame submission has to wait on (0 = nothing to wait for)
+    uint64_t record_acquires(VkCommandBuffer cmd);
+
+    GpuTimeline &timeline() { return m_timeline; }
+    bool separate_queue() const { return m_queueFamily != m_graphicsQueueFamily; }
+    // upload and graphics family, once when they are the same. buffers that keep receiving uploads
+    // while the graphics side reads them are created concurrent between these (vkutil::create_buffer)
+    std::span<const uint32_t> shared_families() const { return {m_families.data(), separate_queue() ? 2u : 1u}; }
+
+private:
+    struct StagingBlock
+    {
+        AllocatedBuffer buffer;
+        VkDeviceSize size{0};
+        VkDeviceSize offset{0};
+    };
+
+    // ownership transfer the graphics side still has to acquire
+    struct Acquire
+    {
+        VkImage image{VK_NULL_HANDLE};
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        // image state right after the release
+        ImageState state{};
+    };
+
+    struct Batch
+    {
+        VkCommandPool pool{VK_NULL_HANDLE};
+        VkCommandBuffer cmd{VK_NULL_HANDLE};
+        std::vector<StagingBlock> staging;
+        std::vector<Acquire> acquires;
+        uint64_t value{0};
+        bool recording{false};
+    };
+
+    // returns the open batch, starting one if needed. m_mutex must be held
+    Batch &open_batch();
+    // copies data into the open batch's staging, returns the buffer / offset to copy from
+    StagingBlock &stage(Batch &batch, const void *data, VkDeviceSize size, VkDeviceSize &offset);
+    StagingBlock create_block(VkDeviceSize size);
+    void release_block(StagingBlock &block);
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    VmaAllocator m_allocator{VK_NULL_HANDLE};
+    VkQueue m_queue{VK_NULL_HANDLE};
+    uint32_t m_queueFamily{0};
+    uint32_t m_graphicsQueueFamily{0};
+    std::array<uint32_t, 2> m_families{};
+    VkDeviceSize m_blockSize{0};
+
+    GpuTimeline m_timeline;
+    std::mutex m_mutex;
+
+    Batch m_open;
+    std::deque<Batch> m_inFlight;
+    std::vector<Batch> m_freeBatches;
+    std::vector<StagingBlock> m_freeBlocks;
+
+    // acquires of submitted batches, handed to the next record_acquires()
+    std::vector<Acquire> m_pendingAcquires;
+    uint64_t m_pendingWait{0};
+    // image transitions of the upload queue, m_mutex
+    BarrierBatcher m_uploadBarriers;
+    // all acquires of a frame go out as one barrier
+    BarrierBatcher m_acquireBarriers;
+};
@@ -11,6 +11,9 @@
 #include <numeric>
 #include <algorithm>
 #include <ranges>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
 
 
 
@@ -23,6 +26,40 @@ void set(std::span<int32_t> data)
     };
 }
 
+// unit cube with flat normals, counter clockwise seen from outside
+uint32_t add_cube_mesh(VulkanRenderer &engine)
+{
+    // normal, u, v with u x v = normal
+    const glm::vec3 faces[6][3] = {
+        {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+        {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}},
+        {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},
+        {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}},
+    };
+    const glm::vec2 corners[4] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (const auto &face : faces)
+    {
+        uint32_t first = (uint32_t)vertices.size();
+        for (const glm::vec2 &corner : corners)
+        {
+            Vertex vertex{};
+            vertex.position = (face[0] + face[1] * corner.x + face[2] * corner.y) * 0.5f;
+            vertex.normal = face[0];
+            vertex.color = glm::vec4(glm::abs(face[0]) * 0.6f + 0.3f, 1.0f);
+            vertices.push_back(vertex);
+        }
+        for (uint32_t index : {0u, 1u, 2u, 0u, 2u, 3u})
+        {
+            indices.push_back(first + index);
+        }
+    }
+    return engine.addMesh(vertices, indices);
+}
+
 void print(std::span<int32_t> data) {
     for (auto &e : data)
     {
@@ -30,8 +67,80 @@ void print(std::span<int32_t> data) {
     };
 }
 
-int main(int, char **)
+// testapp [--headless] [--frames N] [--benchmark N] [--warmup N] [--out file.json] [--no-async-compute] [--frames-in-flight N] [--no-render-thread] [--scene-benchmark N] [--objects N]
+// --benchmark renders N measured frames with a fixed frame clock and writes p50/p95/p99/max timings as json
+// --scene-benchmark builds a scene of N entities and times full transform updates before rendering
+// --objects draws a grid of N cubes through the gpu driven geometry pass
+int main(int argc, char **argv)
 {
+    RendererConfig config;
+#if defined(UFMO_SHADER_DIR)
+    config.shaderDirectory = UFMO_SHADER_DIR;
+#endif
+    uint32_t benchmarkFrames = 0;
+    uint32_t sceneEntities = 0;
+    uint32_t objectCount = 0;
+    uint32_t warmupFrames = 60;
+    std::string benchmarkOutput = "benchmark.json";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            config.headless = true;
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            config.maxFrames = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--benchmark" && i + 1 < argc)
+        {
+            benchmarkFrames = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--warmup" && i + 1 < argc)
+        {
+            warmupFrames = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            benchmarkOutput = argv[++i];
+        }
+        else if (arg == "--no-async-compute")
+        {
+            config.asyncCompute = false;
+        }
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+        {
+            config.framesInFlight = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--no-render-thread")
+        {
+            config.renderThread = false;
+        }
+        else if (arg == "--scene-benchmark" && i + 1 < argc)
+        {
+            sceneEntities = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--objects" && i + 1 < argc)
+        {
+            objectCount = (uint32_t)std::stoul(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "unknown argument " << arg << std::endl;
+            return 1;
+        }
+    }
+    // the object buffer is sized for the grid
+    config.maxSceneObjects = std::max(config.maxSceneObjects, objectCount);
+    if (benchmarkFrames > 0)
+    {
+        config.collectFrameStats = true;
+        config.statsWarmupFrames = warmupFrames;
+        config.maxFrames = warmupFrames + benchmarkFrames;
+        config.fixedDeltaTime = 1.0f / 60.0f;
+    }
+
     size_t MAX_FRAME_IN_FLIGHT = 3;
     auto bad_function = [](const size_t& i, const size_t& iterations) {
         return (i - 1) % iterations;
@@ -74,9 +183,61 @@ int main(int, char **)
     // return 0;
 
     auto engine = new VulkanRenderer();
-    engine->init();
+    if (engine->init(config) != 0)
+    {
+        return 1;
+    }
     // engine->init_vulkan();
+    if (sceneEntities > 0)
+    {
+        // a tree with 8 children per node, about log8(N) levels deep
+        Scene &scene = engine->getScene();
+        std::vector<entt::entity> entities;
+        entities.reserve(sceneEntities);
+        for (uint32_t i = 0; i < sceneEntities; ++i)
+        {
+            Transform transform;
+            transform.position = glm::vec3((float)(i % 8), 1.0f, 0.0f);
+            entities.push_back(scene.create(transform, i == 0 ? entt::null : entities[(i - 1) / 8]));
+        }
+        // the first update sorts the storages
+        scene.update(engine->getJobs());
+
+        std::vector<double> times;
+        for (int i = 0; i < 20; ++i)
+        {
+            scene.mark_all_dirty();
+            auto start = std::chrono::steady_clock::now();
+            scene.update(engine->getJobs());
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        FrameStats::Summary summary = FrameStats::summarize(times);
+        std::cout << "scene update, " << scene.size() << " entities in " << scene.depth_levels() << " levels, "
+                  << engine->getJobs().worker_count() << " workers: p50 " << summary.p50 << " ms, max " << summary.max << " ms" << std::endl;
+    }
+    if (objectCount > 0)
+    {
+        // square grid on the xz plane, the camera looks at it from above one edge
+        Scene &scene = engine->getScene();
+        uint32_t cube = add_cube_mesh(*engine);
+        uint32_t side = (uint32_t)std::ceil(std::sqrt((double)objectCount));
+        for (uint32_t i = 0; i < objectCount; ++i)
+        {
+            Transform transform;
+            transform.position = glm::vec3(2.0f * (float)(i % side) - (float)side, 0.0f, 2.0f * (float)(i / side) - (float)side);
+            engine->addMeshInstance(scene.create(transform), cube);
+        }
+        Camera camera;
+        camera.view = glm::lookAt(glm::vec3(0.0f, (float)side, 1.5f * (float)side + 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        engine->setCamera(camera);
+    }
     engine->run();
+    if (benchmarkFrames > 0)
+    {
+        // latency depends on the queue depth, so the label carries it
+        std::string label = std::string(config.headless ? "headless" : "windowed") + ", " + std::to_string(engine->getFramesInFlight()) + " frames in flight";
+        engine->getFrameStats().writeJson(benchmarkOutput, label);
+    }
     engine->tearDown();
     // std::string helloJim = generateHelloString("Jim");
     // std::cout << helloJim << std::endl;
@@ -0,0 +1,15 @@
+//GLSL version to use
+#version 460
+
+layout (location = 0) in vec3 inColor;
+layout (location = 1) in vec3 inNormal;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main()
+{
+    //one fixed directional light plus some ambient
+    vec3 lightDirection = normalize(vec3(0.3, 1.0, 0.5));
+    float light = max(dot(normalize(inNormal), lightDirection), 0.0) * 0.8 + 0.2;
+    outFragColor = vec4(inColor * light, 1.0);
+}
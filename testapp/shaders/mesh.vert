@@ -0,0 +1,53 @@
+//GLSL version to use
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+struct Vertex
+{
+    vec3 position;
+    float uv_x;
+    vec3 normal;
+    float uv_y;
+    vec4 color;
+};
+
+struct ObjectData
+{
+    mat4 model;
+    uint mesh;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+//vertices are pulled through buffer device addresses, there is no vertex input
+layout(buffer_reference, std430) readonly buffer VertexBuffer
+{
+    Vertex vertices[];
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer
+{
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform Constants
+{
+    mat4 viewProjection;
+    VertexBuffer vertexBuffer;
+    ObjectBuffer objectBuffer;
+} constants;
+
+layout (location = 0) out vec3 outColor;
+layout (location = 1) out vec3 outNormal;
+
+void main()
+{
+    //gl_VertexIndex includes the mesh's vertexOffset, gl_InstanceIndex is the object written by the cull pass
+    Vertex v = constants.vertexBuffer.vertices[gl_VertexIndex];
+    mat4 model = constants.objectBuffer.objects[gl_InstanceIndex].model;
+
+    gl_Position = constants.viewProjection * model * vec4(v.position, 1.0);
+    outColor = v.color.rgb;
+    outNormal = mat3(model) * v.normal;
+}